@@ -0,0 +1,254 @@
+#pragma once
+
+#include <maze.hpp>
+
+#include <functional>
+
+// Progress of an anytime search, reported after every improved path
+struct anytime_report_t
+{
+    cost_t cost{ -1 };
+    float weight{ 1.0f };   // Heuristic inflation the last iteration searched with
+    float bound{ 1.0f };    // The cost is at most this many times the optimum
+    std::size_t expanded{ 0 };
+    int elapsed_ms{ 0 };
+};
+
+// Anytime Repairing A*. The first iteration searches with f = g + w * h for a quick path
+// within w of the optimum, later iterations lower w and reuse every g-value found so far,
+// re-expanding only the states that became inconsistent. Stops at w = 1 or when the time
+// budget runs out, whichever comes first.
+class anytime_solver_t
+{
+public:
+    using report_fn_t = std::function<void(const anytime_report_t&)>;
+
+    explicit anytime_solver_t(maze_t& maze)
+        : m_maze(maze)
+    {
+    }
+
+    anytime_report_t solve(float start_weight, float step, int budget_ms, const report_fn_t& report = report_fn_t())
+    {
+        if (m_maze.start_idx == maze_t::npos || m_maze.end_idx == maze_t::npos)
+            throw std::runtime_error("Maze must have a start (S) and an end (E).");
+
+        util::stopwatch_t sw{};
+        anytime_report_t result{};
+        if (!m_maze.connected(m_maze.start_idx, m_maze.end_idx))
+        {
+            result.elapsed_ms = sw.elapsed_ms();
+            if (report)
+                report(result);
+            return result;
+        }
+
+        float weight = std::max(1.0f, start_weight);
+        reset(weight);
+        step = std::max(0.01f, step);
+
+        while (true)
+        {
+            improve_path(weight);
+
+            result.cost = m_goal_g >= infinite_cost ? -1 : m_goal_g;
+            result.weight = weight;
+            result.bound = bound(weight);
+            result.expanded = m_expanded;
+            result.elapsed_ms = sw.elapsed_ms();
+
+            if (report)
+                report(result);
+
+            if (result.cost < 0 || weight <= 1.0f || result.elapsed_ms >= budget_ms)
+                break;
+
+            weight = std::max(1.0f, weight - step);
+            reopen(weight);
+        }
+
+        return result;
+    }
+
+    // Copies the best path found into the maze so print() can render it
+    void mark_path(const anytime_report_t& result, int solve_time) const
+    {
+        for (std::size_t i = 0; i < m_maze.capacity(); ++i)
+            m_maze.map[i].dir = dir_e::none;
+
+        m_maze.path_cost = result.cost;
+        m_maze.path_bound = result.bound;
+        m_maze.search_count = static_cast<int>(result.expanded);
+        m_maze.solve_time = solve_time;
+
+        if (result.cost >= 0)
+            m_maze.mark_path(m_states.data(), m_goal_state);
+    }
+
+private:
+    enum flag_e : u8 { open = 1, closed = 2, incons = 4 };
+
+    struct entry_t
+    {
+        cost_t f{ 0 };
+        cost_t g{ 0 };
+        std::size_t idx{ 0 };
+    };
+
+    static bool entry_greater(const entry_t& a, const entry_t& b) { return a.f > b.f || (a.f == b.f && a.g < b.g); }
+
+    inline cost_t fvalue(std::size_t s, float weight) const
+    {
+        return m_states[s].g_cost + static_cast<cost_t>(weight * m_states[s].h_cost);
+    }
+
+    void reset(float weight)
+    {
+        m_states.assign(m_maze.capacity() * facings, state_t{});
+        m_flags.assign(m_states.size(), 0);
+        m_open.clear();
+        m_incons.clear();
+        m_closed.clear();
+        m_expanded = 0;
+        m_goal_g = infinite_cost;
+        m_goal_state = 0;
+
+        const std::size_t start = state_id(m_maze.start_idx, (int)dir_e::e);
+        state_t& s = m_states[start];
+        s.dir = dir_e::e;
+        s.p_idx = start;
+        s.h_cost = maze_t::heuristic(m_maze.map[m_maze.start_idx].pos, (int)dir_e::e, m_maze.map[m_maze.end_idx].pos);
+        if (state_tile(start) == m_maze.end_idx)
+        {
+            m_goal_g = 0;
+            m_goal_state = start;
+        }
+        push(start, weight);
+    }
+
+    void push(std::size_t s, float weight)
+    {
+        m_flags[s] |= open;
+        m_open.push_back(entry_t{ fvalue(s, weight), m_states[s].g_cost, s });
+        std::push_heap(m_open.begin(), m_open.end(), entry_greater);
+    }
+
+    // Expands until no open state could still improve the goal under this weight
+    void improve_path(float weight)
+    {
+        const ivec2 goal = m_maze.map[m_maze.end_idx].pos;
+
+        while (!m_open.empty())
+        {
+            const entry_t top = m_open.front();
+            if (!(m_flags[top.idx] & open) || top.g != m_states[top.idx].g_cost)
+            {
+                std::pop_heap(m_open.begin(), m_open.end(), entry_greater);
+                m_open.pop_back();
+                continue;
+            }
+
+            if (m_goal_g <= top.f)
+                break;
+
+            std::pop_heap(m_open.begin(), m_open.end(), entry_greater);
+            m_open.pop_back();
+            m_flags[top.idx] = (m_flags[top.idx] & ~open) | closed;
+            m_closed.push_back(top.idx);
+            ++m_expanded;
+
+            const std::size_t tile = state_tile(top.idx);
+            const cost_t g = m_states[top.idx].g_cost;
+            for (unsigned exits = m_maze.map[tile].exits; exits != 0; exits &= exits - 1)
+            {
+                const int d = util::count_trailing_zeros(exits);
+                const std::size_t n = m_maze.step(tile, d);
+                const std::size_t s = state_id(n, d);
+                const cost_t ng = g + move_cost(state_facing(top.idx), d);
+                state_t& next = m_states[s];
+                if (next.dir != dir_e::none && ng >= next.g_cost)
+                    continue;
+
+                if (next.dir == dir_e::none)
+                    next.h_cost = maze_t::heuristic(m_maze.map[n].pos, d, goal);
+                next.dir = static_cast<dir_e>(d);
+                next.g_cost = ng;
+                next.p_idx = top.idx;
+
+                if (n == m_maze.end_idx && ng < m_goal_g)
+                {
+                    m_goal_g = ng;
+                    m_goal_state = s;
+                }
+
+                // States closed in this iteration wait for the next one
+                if (!(m_flags[s] & closed))
+                {
+                    push(s, weight);
+                }
+                else if (!(m_flags[s] & incons))
+                {
+                    m_flags[s] |= incons;
+                    m_incons.push_back(s);
+                }
+            }
+        }
+    }
+
+    // Suboptimality bound: goal cost over the lowest unweighted f still open or inconsistent
+    float bound(float weight) const
+    {
+        if (m_goal_g >= infinite_cost)
+            return weight;
+
+        cost_t lower = m_goal_g;
+        for (const entry_t& e : m_open)
+            if ((m_flags[e.idx] & open) && e.g == m_states[e.idx].g_cost)
+                lower = std::min(lower, fvalue(e.idx, 1.0f));
+        for (std::size_t s : m_incons)
+            lower = std::min(lower, fvalue(s, 1.0f));
+
+        if (lower <= 0)
+            return weight;
+        return std::min(weight, static_cast<float>(m_goal_g) / static_cast<float>(lower));
+    }
+
+    // Moves the inconsistent states back to open and re-keys everything for the new weight
+    void reopen(float weight)
+    {
+        for (std::size_t s : m_closed)
+            m_flags[s] &= ~closed;
+        m_closed.clear();
+
+        std::vector<entry_t> entries;
+        entries.reserve(m_open.size() + m_incons.size());
+        for (const entry_t& e : m_open)
+        {
+            if ((m_flags[e.idx] & open) && e.g == m_states[e.idx].g_cost && !(m_flags[e.idx] & incons))
+            {
+                m_flags[e.idx] |= incons;   // Reused as a visited mark while deduplicating
+                m_incons.push_back(e.idx);
+            }
+        }
+
+        for (std::size_t s : m_incons)
+        {
+            m_flags[s] = open;
+            entries.push_back(entry_t{ fvalue(s, weight), m_states[s].g_cost, s });
+        }
+        m_incons.clear();
+
+        m_open.swap(entries);
+        std::make_heap(m_open.begin(), m_open.end(), entry_greater);
+    }
+
+    maze_t& m_maze;
+    std::vector<state_t> m_states{};
+    std::vector<u8> m_flags{};
+    std::vector<entry_t> m_open{};
+    std::vector<std::size_t> m_incons{};
+    std::vector<std::size_t> m_closed{};
+    std::size_t m_expanded{ 0 };
+    cost_t m_goal_g{ infinite_cost };
+    std::size_t m_goal_state{ 0 };
+};
@@ -0,0 +1,804 @@
+#pragma once
+
+#include <maze.hpp>
+#include <engines.hpp>
+#include <kpaths.hpp>
+#include <distance_field.hpp>
+
+#include <random>
+#include <iomanip>
+#include <map>
+#include <tuple>
+
+// Synthetic maze families used for benchmarking
+enum struct maze_family_e : u8 { perfect, braided, open };
+
+static const char* family_name(maze_family_e family)
+{
+    switch (family)
+    {
+    case maze_family_e::perfect: return "perfect";
+    case maze_family_e::braided: return "braided";
+    case maze_family_e::open: return "open";
+    default: return "?";
+    }
+}
+
+static maze_family_e parse_family(const std::string& name)
+{
+    if (name == "perfect") return maze_family_e::perfect;
+    if (name == "braided") return maze_family_e::braided;
+    if (name == "open") return maze_family_e::open;
+    throw std::invalid_argument("Unknown maze family: " + name);
+}
+
+// Generates a maze in the puzzle's text format, S in the bottom left and E in the top right.
+// Perfect mazes are carved with an iterative backtracker, braided ones are perfect mazes with
+// a share of walls knocked out to add loops, open ones are scattered walls with no corridors.
+static std::string generate_maze(int size, maze_family_e family, unsigned seed)
+{
+    size |= 1;
+    if (size < 5)
+        throw std::invalid_argument("Generated mazes must be at least 5 wide.");
+
+    std::mt19937 rng(seed);
+    const std::size_t stride = (std::size_t)size + 1;
+    std::string text(stride * size, '#');
+    auto at = [&](int x, int y) -> char& { return text[(std::size_t)y * stride + x]; };
+
+    for (int y = 0; y < size; ++y)
+        at(size, y) = '\n';
+
+    if (family == maze_family_e::open)
+    {
+        std::uniform_int_distribution<int> roll(0, 99);
+        for (int y = 1; y < size - 1; ++y)
+            for (int x = 1; x < size - 1; ++x)
+                at(x, y) = roll(rng) < 25 ? '#' : '.';
+    }
+    else
+    {
+        // Carve passages between the odd cells
+        std::vector<ivec2> stack{ ivec2{ 1, size - 2 } };
+        at(1, size - 2) = '.';
+        while (!stack.empty())
+        {
+            const ivec2 c = stack.back();
+            int options[4];
+            int count = 0;
+            for (int d = 0; d < 4; ++d)
+            {
+                const ivec2 n = c + state_t::moves[d] + state_t::moves[d];
+                if (n.x > 0 && n.x < size - 1 && n.y > 0 && n.y < size - 1 && at(n.x, n.y) == '#')
+                    options[count++] = d;
+            }
+
+            if (count == 0)
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            const int d = options[std::uniform_int_distribution<int>(0, count - 1)(rng)];
+            const ivec2 wall = c + state_t::moves[d];
+            const ivec2 n = wall + state_t::moves[d];
+            at(wall.x, wall.y) = '.';
+            at(n.x, n.y) = '.';
+            stack.push_back(n);
+        }
+
+        if (family == maze_family_e::braided)
+        {
+            std::uniform_int_distribution<int> roll(0, 99);
+            for (int y = 1; y < size - 1; ++y)
+                for (int x = 1 + (y & 1); x < size - 1; x += 2)
+                    if (at(x, y) == '#' && roll(rng) < 10)
+                        at(x, y) = '.';
+        }
+    }
+
+    at(1, size - 2) = 'S';
+    at(size - 2, 1) = 'E';
+    return text;
+}
+
+// One thread and every core, just the one entry on a single-core machine
+static std::vector<int> default_threads()
+{
+    const int cores = std::max(1, (int)std::thread::hardware_concurrency());
+    return cores > 1 ? std::vector<int>{ 1, cores } : std::vector<int>{ 1 };
+}
+
+struct bench_options_t
+{
+    std::vector<int> sizes{ 1001, 2001 };
+    std::vector<int> sweep_sizes{ 1001, 2001, 4001 };   // The sweep's own default, --sizes sets both
+    std::vector<maze_family_e> families{ maze_family_e::perfect, maze_family_e::braided, maze_family_e::open };
+    std::vector<layout_e> layouts{ layout_e::row_major, layout_e::tiled, layout_e::morton };
+    unsigned seed{ 1 };
+    int repeats{ 3 };
+    int edits{ 20 };
+    std::vector<int> threads = default_threads();
+    std::vector<std::string> engines{};
+    std::vector<queue_e> queues{ all_queues() };
+    int kpaths{ 10 };
+    util::page_mode_e pages{ util::page_mode_e::small };
+    int cluster{ hpa_solver_t::default_cluster };
+    std::string out{};              // Sweep results, CSV or JSON by extension
+    std::string baseline{};         // Sweep results to compare against, CSV
+    float threshold{ 10.0f };       // Percent slower than the baseline that counts as a regression
+    double floor_ms{ 2.0 };         // ... and by at least this much, so timer noise on short runs doesn't count
+};
+
+// Solves every generated maze under every layout and prints one row per run.
+// Returns nonzero if layouts disagree on the path cost.
+static int run_bench(const bench_options_t& options)
+{
+    int failures = 0;
+    std::cout << std::left << std::setw(10) << "family" << std::setw(8) << "size" << std::setw(11) << "layout"
+        << std::right << std::setw(10) << "load ms" << std::setw(10) << "solve ms"
+        << std::setw(12) << "cost" << std::setw(12) << "searched" << std::setw(10) << "B/tile"
+        << std::setw(12) << "peak open" << std::endl;
+
+    for (maze_family_e family : options.families)
+    {
+        for (int size : options.sizes)
+        {
+            const std::string text = generate_maze(size, family, options.seed);
+            cost_t expected_cost = 0;
+
+            for (std::size_t l = 0; l < options.layouts.size(); ++l)
+            {
+                maze_t maze{};
+                maze.tile_arena.set_pages(options.pages);
+                maze.search_arena.set_pages(options.pages);
+                util::stopwatch_t sw{};
+                maze.parse(text, options.layouts[l]);
+                const float load_ms = sw.elapsed<std::chrono::duration<float, std::milli>>().count();
+
+                float solve_ms = 0.0f;
+                for (int r = 0; r < options.repeats; ++r)
+                {
+                    sw.start();
+                    maze.solve();
+                    const float ms = sw.elapsed<std::chrono::duration<float, std::milli>>().count();
+                    solve_ms = (r == 0) ? ms : std::min(solve_ms, ms);
+                }
+
+                if (l == 0)
+                    expected_cost = maze.path_cost;
+                else if (maze.path_cost != expected_cost)
+                    ++failures;
+
+                std::cout << std::left << std::setw(10) << family_name(family) << std::setw(8) << maze.size.x
+                    << std::setw(11) << layout_t::name(options.layouts[l]) << std::right << std::fixed << std::setprecision(1)
+                    << std::setw(10) << load_ms << std::setw(10) << solve_ms
+                    << std::setw(12) << maze.path_cost << std::setw(12) << maze.search_count
+                    << std::setw(10) << maze.bytes_per_tile() << std::setw(12) << maze.peak_open
+                    << (maze.path_cost != expected_cost ? "  MISMATCH" : "") << std::endl;
+
+                maze.unload();
+            }
+        }
+    }
+
+    std::cout << "Peak RSS: " << util::format_bytes(util::peak_rss_bytes()) << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// Toggles single tiles and compares the incremental re-solve against solving from scratch.
+// Every other edit walls off a tile of the current path so the repair has real work to do.
+// Returns nonzero if the two ever disagree on the cost.
+static int run_incremental_bench(const bench_options_t& options)
+{
+    int failures = 0;
+    std::cout << std::left << std::setw(10) << "family" << std::setw(8) << "size"
+        << std::right << std::setw(12) << "full ms" << std::setw(12) << "repair ms"
+        << std::setw(14) << "full exp" << std::setw(14) << "repair exp" << std::endl;
+
+    for (maze_family_e family : options.families)
+    {
+        for (int size : options.sizes)
+        {
+            maze_t maze{};
+            maze.parse(generate_maze(size, family, options.seed));
+            std::mt19937 rng(options.seed);
+
+            incremental_solver_t solver(maze);
+            solver.solve();
+
+            double full_ms = 0.0, repair_ms = 0.0;
+            double full_exp = 0.0, repair_exp = 0.0;
+            for (int e = 0; e < options.edits; ++e)
+            {
+                ivec2 pos{};
+                const std::vector<std::size_t> path = solver.path();
+                if ((e & 1) && path.size() > 2)
+                {
+                    pos = maze.map[state_tile(path[1 + rng() % (path.size() - 2)])].pos;
+                }
+                else
+                {
+                    pos = ivec2{ 1 + (int)(rng() % (maze.size.x - 2)), 1 + (int)(rng() % (maze.size.y - 2)) };
+                }
+
+                const tile_e type = maze.get(pos.x, pos.y).type;
+                if (type == tile_e::start || type == tile_e::end)
+                    continue;
+
+                solver.apply({ tile_edit_t{ pos, type == tile_e::wall ? tile_e::empty : tile_e::wall } });
+
+                util::stopwatch_t sw{};
+                const cost_t repaired = solver.solve();
+                repair_ms += sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+                repair_exp += solver.expanded();
+
+                incremental_solver_t fresh(maze);
+                sw.start();
+                const cost_t full = fresh.solve();
+                full_ms += sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+                full_exp += fresh.expanded();
+
+                if (full != repaired)
+                {
+                    std::cout << "MISMATCH after editing " << pos.x << "," << pos.y
+                        << ": " << repaired << " vs " << full << std::endl;
+                    ++failures;
+                }
+            }
+
+            const double n = std::max(1, options.edits);
+            std::cout << std::left << std::setw(10) << family_name(family) << std::setw(8) << maze.size.x
+                << std::right << std::fixed << std::setprecision(2)
+                << std::setw(12) << full_ms / n << std::setw(12) << repair_ms / n
+                << std::setprecision(0) << std::setw(14) << full_exp / n << std::setw(14) << repair_exp / n << std::endl;
+
+            maze.unload();
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+// Runs every engine, parallel ones once per thread count, and checks them against A*.
+// Returns nonzero if any engine disagrees on the cost.
+static int run_engine_bench(const bench_options_t& options)
+{
+    int failures = 0;
+    std::cout << std::left << std::setw(10) << "family" << std::setw(8) << "size" << std::setw(8) << "engine"
+        << std::right << std::setw(8) << "threads" << std::setw(10) << "solve ms" << std::setw(10) << "speedup"
+        << std::setw(12) << "cost" << std::endl;
+
+    for (maze_family_e family : options.families)
+    {
+        for (int size : options.sizes)
+        {
+            maze_t maze{};
+            maze.parse(generate_maze(size, family, options.seed));
+
+            maze.solve();
+            const cost_t expected = maze.path_cost;
+            double baseline_ms = 0.0;
+
+            for (const engine_t& engine : engines())
+            {
+                if (!options.engines.empty() &&
+                    std::find(options.engines.begin(), options.engines.end(), engine.name) == options.engines.end())
+                    continue;
+
+                const std::vector<int> thread_counts = engine.parallel ? options.threads : std::vector<int>{ 1 };
+                for (int threads : thread_counts)
+                {
+                    double best_ms = 0.0;
+                    for (int r = 0; r < options.repeats; ++r)
+                    {
+                        util::stopwatch_t sw{};
+                        engine.run(maze, threads);
+                        const double ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+                        best_ms = (r == 0) ? ms : std::min(best_ms, ms);
+                    }
+
+                    if (baseline_ms == 0.0)
+                        baseline_ms = best_ms;
+
+                    const bool mismatch = maze.path_cost != expected;
+                    failures += mismatch ? 1 : 0;
+                    std::cout << std::left << std::setw(10) << family_name(family) << std::setw(8) << maze.size.x
+                        << std::setw(8) << engine.name << std::right << std::setw(8) << threads
+                        << std::fixed << std::setprecision(1) << std::setw(10) << best_ms
+                        << std::setprecision(2) << std::setw(10) << baseline_ms / std::max(best_ms, 1e-6)
+                        << std::setw(12) << maze.path_cost << (mismatch ? "  MISMATCH" : "") << std::endl;
+                }
+            }
+
+            maze.unload();
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+// Builds the cluster abstraction once, then times repeated queries against plain A*.
+// Returns nonzero if the two disagree on the cost.
+static int run_hierarchy_bench(const bench_options_t& options)
+{
+    int failures = 0;
+    std::cout << std::left << std::setw(10) << "family" << std::setw(8) << "size"
+        << std::right << std::setw(10) << "astar ms" << std::setw(10) << "build ms" << std::setw(10) << "query ms"
+        << std::setw(10) << "nodes" << std::setw(10) << "edges" << std::setw(12) << "cost" << std::endl;
+
+    for (maze_family_e family : options.families)
+    {
+        for (int size : options.sizes)
+        {
+            maze_t maze{};
+            maze.parse(generate_maze(size, family, options.seed));
+
+            util::stopwatch_t sw{};
+            maze.solve();
+            const double astar_ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+            const cost_t expected = maze.path_cost;
+
+            hpa_solver_t solver(maze, options.cluster);
+            sw.start();
+            solver.build();
+            const double build_ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+
+            double query_ms = 0.0;
+            cost_t cost = -1;
+            for (int r = 0; r < options.repeats; ++r)
+            {
+                sw.start();
+                cost = solver.solve();
+                const double ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+                query_ms = (r == 0) ? ms : std::min(query_ms, ms);
+            }
+
+            const bool mismatch = cost != expected;
+            failures += mismatch ? 1 : 0;
+            std::cout << std::left << std::setw(10) << family_name(family) << std::setw(8) << maze.size.x
+                << std::right << std::fixed << std::setprecision(1)
+                << std::setw(10) << astar_ms << std::setw(10) << build_ms << std::setw(10) << query_ms
+                << std::setw(10) << solver.nodes() << std::setw(10) << solver.edges()
+                << std::setw(12) << cost << (mismatch ? "  MISMATCH" : "") << std::endl;
+
+            maze.unload();
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+// Runs the same query from several threads at once on one loaded maze, each with its own
+// scratch arena, and checks every thread gets the sequential answer.
+// Returns nonzero if any of them differs.
+static int run_query_bench(const bench_options_t& options)
+{
+    int failures = 0;
+    std::cout << std::left << std::setw(10) << "family" << std::setw(8) << "size"
+        << std::right << std::setw(8) << "threads" << std::setw(10) << "queries" << std::setw(12) << "total ms"
+        << std::setw(12) << "per query" << std::setw(12) << "cost" << std::endl;
+
+    for (maze_family_e family : options.families)
+    {
+        for (int size : options.sizes)
+        {
+            maze_t maze{};
+            maze.parse(generate_maze(size, family, options.seed));
+            const solve_result_t expected = maze.query();
+
+            for (int threads : options.threads)
+            {
+                util::thread_pool_t pool(std::max(1, threads) - 1);
+                const std::size_t queries = (std::size_t)pool.concurrency() * options.repeats;
+                std::vector<util::arena_t> arenas(pool.concurrency());
+                std::atomic<int> wrong{ 0 };
+
+                util::stopwatch_t sw{};
+                util::parallel_for(pool, 0, queries, 1, [&](std::size_t begin, std::size_t end)
+                {
+                    util::arena_t& scratch = arenas[pool.slot() % arenas.size()];
+                    for (std::size_t q = begin; q < end; ++q)
+                    {
+                        const solve_result_t result = maze.query(1.0f, scratch);
+                        if (result.cost != expected.cost || result.path != expected.path)
+                            wrong.fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+                const double ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+
+                failures += wrong.load() > 0 ? 1 : 0;
+                std::cout << std::left << std::setw(10) << family_name(family) << std::setw(8) << maze.size.x
+                    << std::right << std::setw(8) << pool.concurrency() << std::setw(10) << queries
+                    << std::fixed << std::setprecision(1) << std::setw(12) << ms << std::setw(12) << ms / queries
+                    << std::setw(12) << expected.cost << (wrong.load() > 0 ? "  MISMATCH" : "") << std::endl;
+            }
+
+            maze.unload();
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+// Solves every generated maze with every open list backend and prints one row per run, so the
+// right queue for a family can be picked from numbers. Returns nonzero if two queues disagree
+// on the path cost.
+static int run_queue_bench(const bench_options_t& options)
+{
+    int failures = 0;
+    std::cout << std::left << std::setw(10) << "family" << std::setw(8) << "size" << std::setw(10) << "queue"
+        << std::right << std::setw(10) << "solve ms" << std::setw(12) << "cost" << std::setw(12) << "expanded"
+        << std::setw(12) << "peak open" << std::setw(12) << "open list" << std::endl;
+
+    util::arena_t scratch{};
+    for (maze_family_e family : options.families)
+    {
+        for (int size : options.sizes)
+        {
+            maze_t maze{};
+            maze.parse(generate_maze(size, family, options.seed));
+            cost_t expected = -2;
+
+            for (queue_e queue : options.queues)
+            {
+                double best_ms = 0.0;
+                solve_result_t result{};
+                for (int r = 0; r < options.repeats; ++r)
+                {
+                    util::stopwatch_t sw{};
+                    result = maze.query(1.0f, scratch, queue);
+                    const double ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+                    best_ms = (r == 0) ? ms : std::min(best_ms, ms);
+                }
+
+                if (expected == -2)
+                    expected = result.cost;
+                const bool mismatch = result.cost != expected;
+                failures += mismatch ? 1 : 0;
+
+                std::cout << std::left << std::setw(10) << family_name(family) << std::setw(8) << maze.size.x
+                    << std::setw(10) << queue_name(queue) << std::right << std::fixed << std::setprecision(1)
+                    << std::setw(10) << best_ms << std::setw(12) << result.cost << std::setw(12) << result.expanded
+                    << std::setw(12) << result.peak_open << std::setw(12) << util::format_bytes(result.open_bytes)
+                    << (mismatch ? "  MISMATCH" : "") << std::endl;
+            }
+
+            maze.unload();
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+// Times k shortest routes against one A* solve of the same maze. Returns nonzero if the first
+// route isn't the optimum or the routes come out of cost order.
+static int run_kpaths_bench(const bench_options_t& options)
+{
+    int failures = 0;
+    std::cout << std::left << std::setw(10) << "family" << std::setw(8) << "size" << std::right
+        << std::setw(11) << "junctions" << std::setw(11) << "solve ms" << std::setw(11) << "build ms"
+        << std::setw(11) << "k ms" << std::setw(8) << "routes" << std::setw(10) << "x solve"
+        << std::setw(12) << "best" << std::setw(12) << "worst" << std::endl;
+
+    for (maze_family_e family : options.families)
+    {
+        for (int size : options.sizes)
+        {
+            maze_t maze{};
+            maze.parse(generate_maze(size, family, options.seed));
+
+            util::stopwatch_t sw{};
+            const solve_result_t single = maze.query();
+            const double solve_ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+
+            kpaths_solver_t solver(maze);
+            sw.start();
+            solver.build();
+            const double build_ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+            sw.start();
+            const std::vector<route_t> routes = solver.solve(options.kpaths);
+            const double k_ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+
+            bool wrong = routes.empty() ? single.found() : routes.front().cost != single.cost;
+            for (std::size_t r = 1; r < routes.size(); ++r)
+                wrong = wrong || routes[r].cost < routes[r - 1].cost;
+            failures += wrong ? 1 : 0;
+
+            std::cout << std::left << std::setw(10) << family_name(family) << std::setw(8) << maze.size.x << std::right
+                << std::setw(11) << solver.junctions() << std::fixed << std::setprecision(1) << std::setw(11) << solve_ms
+                << std::setw(11) << build_ms << std::setw(11) << k_ms << std::setw(8) << routes.size()
+                << std::setw(10) << (build_ms + k_ms) / std::max(solve_ms, 1e-3)
+                << std::setw(12) << (routes.empty() ? -1 : routes.front().cost)
+                << std::setw(12) << (routes.empty() ? -1 : routes.back().cost) << (wrong ? "  MISMATCH" : "") << std::endl;
+
+            maze.unload();
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+// Builds the distance field to E and answers queries from random open tiles with it, checking
+// each against a search from the same tile. Returns nonzero on any disagreement.
+static int run_field_bench(const bench_options_t& options)
+{
+    int failures = 0;
+    std::cout << std::left << std::setw(10) << "family" << std::setw(8) << "size" << std::right
+        << std::setw(11) << "solve ms" << std::setw(11) << "build ms" << std::setw(10) << "field"
+        << std::setw(10) << "queries" << std::setw(13) << "lookup us" << std::setw(13) << "descent us"
+        << std::setw(13) << "search us" << std::endl;
+
+    util::arena_t scratch{};
+    for (maze_family_e family : options.families)
+    {
+        for (int size : options.sizes)
+        {
+            maze_t maze{};
+            maze.parse(generate_maze(size, family, options.seed));
+
+            util::stopwatch_t sw{};
+            const solve_result_t single = maze.query(1.0f, scratch);
+            const double solve_ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+
+            distance_field_t field(maze);
+            field.build();
+
+            // Random open starts facing east, the same ones for each method
+            std::mt19937 rng(options.seed);
+            std::uniform_int_distribution<int> pick_x(0, maze.size.x - 1), pick_y(0, maze.size.y - 1);
+            std::vector<std::size_t> starts;
+            while (starts.size() < 100 * (std::size_t)options.repeats)
+            {
+                const std::size_t t = maze.idx(pick_x(rng), pick_y(rng));
+                if (maze.is_open(t))
+                    starts.push_back(t);
+            }
+
+            cost_t checksum = 0;
+            sw.start();
+            for (std::size_t t : starts)
+                checksum += field.cost(t, (int)dir_e::e);
+            const double lookup_us = sw.elapsed<std::chrono::duration<double, std::micro>>().count() / starts.size();
+
+            std::vector<solve_result_t> answers;
+            sw.start();
+            for (std::size_t t : starts)
+                answers.push_back(field.answer(t, (int)dir_e::e));
+            const double descent_us = sw.elapsed<std::chrono::duration<double, std::micro>>().count() / starts.size();
+
+            // Searches are slow next to lookups, so only a few of them check the answers
+            const std::size_t checks = std::min<std::size_t>(starts.size(), 10);
+            cost_t descended = 0;
+            for (const solve_result_t& a : answers)
+                descended += a.cost;
+            bool wrong = field.cost(maze.start_idx, (int)dir_e::e) != single.cost || checksum != descended;
+            sw.start();
+            for (std::size_t q = 0; q < checks; ++q)
+            {
+                endpoints_t endpoints{};
+                endpoints.starts = &starts[q];
+                endpoints.start_count = 1;
+                endpoints.goals = &maze.end_idx;
+                endpoints.goal_count = 1;
+                const solve_result_t searched = maze.search(1.0f, scratch, endpoints, queue_e::binary);
+                wrong = wrong || searched.cost != answers[q].cost;
+            }
+            const double search_us = sw.elapsed<std::chrono::duration<double, std::micro>>().count() / checks;
+            failures += wrong ? 1 : 0;
+
+            std::cout << std::left << std::setw(10) << family_name(family) << std::setw(8) << maze.size.x << std::right
+                << std::fixed << std::setprecision(1) << std::setw(11) << solve_ms << std::setw(11) << (double)field.build_time()
+                << std::setw(10) << util::format_bytes(field.bytes()) << std::setw(10) << starts.size()
+                << std::setprecision(2) << std::setw(13) << lookup_us << std::setw(13) << descent_us << std::setw(13) << search_us
+                << (wrong ? "  MISMATCH" : "") << std::endl;
+
+            maze.unload();
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+// The checked-in puzzles and their answers, every sweep solves them first
+static const std::vector<std::pair<std::string, cost_t>>& known_answers()
+{
+    static const std::vector<std::pair<std::string, cost_t>> answers =
+    {
+        { WD"/ex1.txt", 7036 },
+        { WD"/ex2.txt", 11048 },
+        { WD"/input.txt", 107468 },
+    };
+    return answers;
+}
+
+struct sweep_row_t
+{
+    std::string family;
+    int size{ 0 };
+    std::string engine;
+    int threads{ 1 };
+    double ms{ 0.0 };
+    cost_t cost{ -1 };
+
+    inline std::tuple<std::string, int, std::string, int> key() const { return { family, size, engine, threads }; }
+};
+
+static void write_sweep(const std::vector<sweep_row_t>& rows, const std::string& filepath)
+{
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3);
+    const bool json = filepath.size() >= 5 && filepath.compare(filepath.size() - 5, 5, ".json") == 0;
+    if (json)
+    {
+        oss << "[" << std::endl;
+        for (std::size_t i = 0; i < rows.size(); ++i)
+        {
+            const sweep_row_t& r = rows[i];
+            oss << "  { \"family\": \"" << r.family << "\", \"size\": " << r.size << ", \"engine\": \"" << r.engine
+                << "\", \"threads\": " << r.threads << ", \"ms\": " << r.ms << ", \"cost\": " << r.cost << " }"
+                << (i + 1 < rows.size() ? "," : "") << std::endl;
+        }
+        oss << "]" << std::endl;
+    }
+    else
+    {
+        oss << "family,size,engine,threads,ms,cost" << std::endl;
+        for (const sweep_row_t& r : rows)
+            oss << r.family << "," << r.size << "," << r.engine << "," << r.threads << "," << r.ms << "," << r.cost << std::endl;
+    }
+    util::write_file(filepath.c_str(), oss.str());
+}
+
+static std::vector<sweep_row_t> read_sweep(const std::string& filepath)
+{
+    std::vector<sweep_row_t> rows;
+    const std::vector<std::string> lines = util::read_file(filepath.c_str());
+    for (std::size_t i = 1; i < lines.size(); ++i)
+    {
+        std::istringstream iss(lines[i]);
+        std::string field;
+        std::vector<std::string> fields;
+        while (std::getline(iss, field, ','))
+            fields.push_back(field);
+        if (fields.size() != 6)
+            throw std::runtime_error("Malformed baseline line: " + lines[i]);
+
+        rows.push_back(sweep_row_t{ fields[0], std::stoi(fields[1]), fields[2], std::stoi(fields[3]), std::stod(fields[4]), std::stoll(fields[5]) });
+    }
+    return rows;
+}
+
+// One command for "did this change make things faster or slower". Checks the known answers
+// with every engine, times every engine on every family, size and thread count, optionally
+// saves the results, and compares them against a saved baseline. Returns nonzero on a wrong
+// answer, an engine disagreeing with A*, or a run slower than the baseline by more than the
+// threshold and the floor. Each time is the best of the repeats.
+//
+// The default sizes stop at 4001, about 2.5 GB of search state per engine. Larger mazes need
+// around 150 bytes per tile, so a 50k x 50k sweep (--sizes=...,50001) needs a machine with
+// several hundred GB of memory.
+static int run_sweep_bench(const bench_options_t& options)
+{
+    int failures = 0;
+    auto selected = [&](const engine_t& engine)
+    {
+        return options.engines.empty() ||
+            std::find(options.engines.begin(), options.engines.end(), engine.name) != options.engines.end();
+    };
+
+    for (const auto& answer : known_answers())
+    {
+        maze_t maze{};
+        maze.load(answer.first.c_str());
+        for (const engine_t& engine : engines())
+        {
+            if (!selected(engine))
+                continue;
+            engine.run(maze, 0);
+            if (maze.path_cost != answer.second)
+            {
+                std::cout << "WRONG ANSWER from " << engine.name << " on " << answer.first << ": "
+                    << maze.path_cost << " instead of " << answer.second << std::endl;
+                ++failures;
+            }
+        }
+        maze.unload();
+    }
+    std::cout << "Known answers: " << (failures == 0 ? "ok" : "FAILED") << std::endl;
+
+    // Each (family, size, engine, threads) is one row, and the key into the baseline
+    std::vector<int> threads = options.threads;
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+    std::vector<sweep_row_t> rows;
+    std::cout << std::left << std::setw(10) << "family" << std::setw(8) << "size" << std::setw(8) << "engine"
+        << std::right << std::setw(8) << "threads" << std::setw(12) << "solve ms" << std::setw(14) << "cost" << std::endl;
+
+    for (maze_family_e family : options.families)
+    {
+        for (int size : options.sweep_sizes)
+        {
+            maze_t maze{};
+            maze.parse(generate_maze(size, family, options.seed));
+            cost_t expected = -2;
+
+            for (const engine_t& engine : engines())
+            {
+                if (!selected(engine))
+                    continue;
+
+                const std::vector<int> thread_counts = engine.parallel ? threads : std::vector<int>{ 1 };
+                for (int threads : thread_counts)
+                {
+                    double best_ms = 0.0;
+                    for (int r = 0; r < options.repeats; ++r)
+                    {
+                        util::stopwatch_t sw{};
+                        engine.run(maze, threads);
+                        const double ms = sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+                        best_ms = (r == 0) ? ms : std::min(best_ms, ms);
+                    }
+
+                    // The first engine run sets the answer the others have to match
+                    if (expected == -2)
+                        expected = maze.path_cost;
+                    const bool mismatch = maze.path_cost != expected;
+                    failures += mismatch ? 1 : 0;
+
+                    rows.push_back(sweep_row_t{ family_name(family), maze.size.x, engine.name, threads, best_ms, maze.path_cost });
+                    std::cout << std::left << std::setw(10) << family_name(family) << std::setw(8) << maze.size.x
+                        << std::setw(8) << engine.name << std::right << std::setw(8) << threads
+                        << std::fixed << std::setprecision(1) << std::setw(12) << best_ms
+                        << std::setw(14) << maze.path_cost << (mismatch ? "  MISMATCH" : "") << std::endl;
+                }
+            }
+
+            maze.unload();
+        }
+    }
+
+    if (!options.out.empty())
+        write_sweep(rows, options.out);
+
+    if (!options.baseline.empty())
+    {
+        std::map<std::tuple<std::string, int, std::string, int>, sweep_row_t> baseline;
+        for (const sweep_row_t& r : read_sweep(options.baseline))
+            baseline[r.key()] = r;
+
+        int regressions = 0, compared = 0;
+        double log_ratio = 0.0;
+        std::cout << std::endl << "Against " << options.baseline << " (threshold " << options.threshold << "% and "
+            << options.floor_ms << " ms)" << std::endl;
+        for (const sweep_row_t& r : rows)
+        {
+            const auto it = baseline.find(r.key());
+            if (it == baseline.end())
+                continue;
+
+            const sweep_row_t& b = it->second;
+            const double change = 100.0 * (r.ms - b.ms) / std::max(b.ms, 1e-3);
+            const bool wrong = r.cost != b.cost;
+            const bool slower = change > options.threshold && r.ms - b.ms > options.floor_ms;
+            regressions += (wrong || slower) ? 1 : 0;
+            log_ratio += std::log(std::max(r.ms, 1e-3) / std::max(b.ms, 1e-3));
+            ++compared;
+
+            if (wrong || slower)
+            {
+                std::cout << "  " << r.family << " " << r.size << " " << r.engine << " x" << r.threads << ": "
+                    << std::fixed << std::setprecision(1) << b.ms << " -> " << r.ms << " ms (" << std::showpos << change
+                    << std::noshowpos << "%)" << (wrong ? ", cost changed" : "") << std::endl;
+            }
+        }
+
+        const double geomean = compared > 0 ? 100.0 * (std::exp(log_ratio / compared) - 1.0) : 0.0;
+        std::cout << "Compared " << compared << " runs, " << regressions << " regressed. Overall "
+            << std::fixed << std::setprecision(1) << std::showpos << geomean << std::noshowpos << "% (geometric mean)" << std::endl;
+        failures += regressions;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#include <daemon.hpp>
+
+int main(int argc, char** args)
+{
+    /*
+    * Talks to a running `app --daemon`.
+    *
+    * Usage: client [--socket=PATH] load FILE [NAME]
+    *        client [--socket=PATH] solve KEY [REPEATS]
+    *        client [--socket=PATH] unload KEY
+    *        client [--socket=PATH] list
+    *        client [--socket=PATH] shutdown
+    */
+
+#if MAZE_DAEMON
+    try
+    {
+        std::string socket_path = default_socket_path;
+        std::vector<std::string> positional;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = args[i];
+            if (arg.compare(0, 9, "--socket=") == 0) { socket_path = arg.substr(9); }
+            else { positional.push_back(arg); }
+        }
+
+        if (positional.empty())
+            throw std::invalid_argument("Missing command.");
+
+        const std::string& command = positional[0];
+        auto arg = [&](std::size_t i) -> std::string
+        {
+            if (i >= positional.size())
+                throw std::invalid_argument("Missing argument for " + command);
+            return positional[i];
+        };
+
+        daemon_client_t client(socket_path);
+        if (command == "load")
+        {
+            const std::string name = positional.size() > 2 ? positional[2] : "";
+            const std::string reply = client.call(message_writer_t{}.put(u8(daemon_op_e::load)).put(name).put(arg(1)));
+            message_reader_t in{ reply };
+            const std::string key = in.get_string();
+            const std::uint32_t w = in.get<std::uint32_t>();
+            const std::uint32_t h = in.get<std::uint32_t>();
+            std::cout << "Loaded " << key << ": " << w << " x " << h << ", pruned " << in.get<std::uint64_t>() << " tiles" << std::endl;
+        }
+        else if (command == "solve")
+        {
+            const int repeats = positional.size() > 2 ? std::max(1, std::stoi(positional[2])) : 1;
+            const message_writer_t request = message_writer_t{}.put(u8(daemon_op_e::solve)).put(arg(1));
+
+            // Round trips are timed here, the daemon reports the search time alone
+            double round_trip_us = 0.0, search_us = 0.0;
+            std::string reply;
+            for (int r = 0; r < repeats; ++r)
+            {
+                util::stopwatch_t sw{};
+                reply = client.call(request);
+                round_trip_us += sw.elapsed<std::chrono::duration<double, std::micro>>().count();
+                message_reader_t in{ reply };
+                in.offset = sizeof(std::int64_t) + 2 * sizeof(std::uint64_t);
+                search_us += static_cast<double>(in.get<std::uint64_t>());
+            }
+
+            message_reader_t in{ reply };
+            const std::int64_t cost = in.get<std::int64_t>();
+            const std::uint64_t expanded = in.get<std::uint64_t>();
+            in.get<std::uint64_t>();
+            in.get<std::uint64_t>();
+            std::cout << "Best path cost " << cost << " points. Expanded " << expanded << " states" << std::endl;
+            std::cout << "Average over " << repeats << ": search " << search_us / repeats << " us, round trip "
+                << round_trip_us / repeats << " us" << std::endl;
+            std::cout << "Moves: " << in.get_string() << std::endl;
+        }
+        else if (command == "unload")
+        {
+            client.call(message_writer_t{}.put(u8(daemon_op_e::unload)).put(arg(1)));
+        }
+        else if (command == "list")
+        {
+            const std::string reply = client.call(message_writer_t{}.put(u8(daemon_op_e::list)));
+            message_reader_t in{ reply };
+            for (std::uint32_t n = in.get<std::uint32_t>(); n > 0; --n)
+                std::cout << in.get_string() << std::endl;
+        }
+        else if (command == "shutdown")
+        {
+            client.call(message_writer_t{}.put(u8(daemon_op_e::shutdown)));
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown command: " + command);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+#else
+    (void)argc;
+    (void)args;
+    std::cerr << "Error: The daemon needs Unix domain sockets." << std::endl;
+    return 1;
+#endif
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <maze.hpp>
+
+// Path-only output. Instead of the whole grid this writes print()'s summary, the length of
+// the path and its moves run-length encoded relative to the current facing, so the output
+// grows with the path rather than with the maze:
+//
+//   Path tiles: 42
+//   Start: 1,13 facing E
+//   Moves: F2 L F4 R F10 U F1
+//
+// Fn moves n tiles straight on; R, L and U turn right, left and around before the next move.
+// render_compact_path() replays a file like this onto the loaded maze, so the full grid can
+// still be drawn with print() when someone wants to look at it.
+
+static constexpr char compass[] = { 'N', 'S', 'E', 'W' };
+
+// Direction after a quarter turn clockwise, indexed by dir_e
+inline int turn_right(int dir)
+{
+    static constexpr int right[] = { (int)dir_e::e, (int)dir_e::w, (int)dir_e::s, (int)dir_e::n };
+    return right[dir];
+}
+
+inline int turn_left(int dir) { return opposite(turn_right(dir)); }
+
+// Follows the marked path from S. A marked tile records the direction it was entered by, so
+// the next tile is the neighbour that was entered from this one.
+inline std::vector<std::size_t> marked_path(const maze_t& maze)
+{
+    std::vector<std::size_t> states;
+    if (maze.path_cost < 0 || maze.start_idx == maze_t::npos)
+        return states;
+
+    std::size_t tile = maze.start_idx;
+    int facing = (int)dir_e::e;
+    states.push_back(state_id(tile, facing));
+
+    while (tile != maze.end_idx)
+    {
+        int next = -1;
+        for (int d = 0; d < 4 && next < 0; ++d)
+        {
+            const std::ptrdiff_t n = maze.neighbor(tile, d);
+            if (n < 0 || static_cast<std::size_t>(n) == maze.start_idx)
+                continue;
+            if (maze.map[n].dir == (dir_e)(d | (int)dir_e::path))
+                next = d;
+        }
+
+        if (next < 0 || states.size() > maze.capacity())
+            throw std::runtime_error("The marked path is broken.");
+
+        tile = static_cast<std::size_t>(maze.neighbor(tile, next));
+        facing = next;
+        states.push_back(state_id(tile, facing));
+    }
+    return states;
+}
+
+inline std::string encode_moves(const std::vector<std::size_t>& states)
+{
+    std::ostringstream oss;
+    int facing = states.empty() ? (int)dir_e::e : state_facing(states.front());
+    std::size_t run = 0;
+
+    auto flush = [&]()
+    {
+        if (run > 0)
+            oss << (oss.tellp() > 0 ? " " : "") << 'F' << run;
+        run = 0;
+    };
+
+    for (std::size_t i = 1; i < states.size(); ++i)
+    {
+        const int dir = state_facing(states[i]);
+        if (dir != facing)
+        {
+            flush();
+            oss << (oss.tellp() > 0 ? " " : "")
+                << (dir == turn_right(facing) ? 'R' : dir == turn_left(facing) ? 'L' : 'U');
+            facing = dir;
+        }
+        ++run;
+    }
+    flush();
+    return oss.str();
+}
+
+// Writes the summary and the given path, states from S to E as in solve_result_t::path
+inline void write_compact_path(const maze_t& maze, const std::vector<std::size_t>& states, const char* filepath)
+{
+    const std::string summary = maze.header();
+    std::cout << summary;
+
+    std::ostringstream oss;
+    oss << summary;
+
+    if (!states.empty())
+    {
+        const ivec2 start = maze.map[state_tile(states.front())].pos;
+        oss << "Path tiles: " << states.size() << std::endl;
+        oss << "Start: " << start.x << "," << start.y << " facing " << compass[state_facing(states.front())] << std::endl;
+        oss << "Moves: " << encode_moves(states) << std::endl;
+    }
+
+    util::write_file(filepath, oss.str());
+}
+
+// Writes the path marked in the maze, whichever engine marked it. The marks are followed from
+// the first S to the first E, so paths between other endpoints go through the overload above.
+inline void write_compact_path(const maze_t& maze, const char* filepath)
+{
+    write_compact_path(maze, marked_path(maze), filepath);
+}
+
+// Replays a compact path onto the loaded maze and marks it, checking every move stays on open
+// tiles and the walk ends on an E
+inline void render_compact_path(maze_t& maze, const char* filepath)
+{
+    for (std::size_t i = 0; i < maze.capacity(); ++i)
+        maze.map[i].dir = dir_e::none;
+    maze.path_cost = -1;
+
+    ivec2 pos{ -1, -1 };
+    int facing = -1;
+    std::string moves;
+    bool has_moves = false;
+
+    for (const std::string& line : util::read_file(filepath))
+    {
+        std::istringstream iss(line);
+        std::string key;
+        iss >> key;
+
+        if (key == "Best")
+        {
+            std::string path, word, cost;
+            iss >> path >> word >> cost;
+            maze.path_cost = std::stoll(cost);
+        }
+        else if (key == "Start:")
+        {
+            char comma = 0, dir = 0;
+            std::string word;
+            iss >> pos.x >> comma >> pos.y >> word >> dir;
+            facing = static_cast<int>(std::find(std::begin(compass), std::end(compass), dir) - std::begin(compass));
+        }
+        else if (key == "Moves:")
+        {
+            std::getline(iss, moves);
+            has_moves = true;
+        }
+    }
+
+    if (!has_moves || facing < 0 || facing >= 4 || pos.x < 0 || pos.x >= maze.size.x || pos.y < 0 || pos.y >= maze.size.y)
+        throw std::runtime_error("No path in file.");
+
+    std::size_t tile = maze.idx(pos.x, pos.y);
+    maze.map[tile].dir = (dir_e)(facing | (int)dir_e::path);
+
+    std::istringstream iss(moves);
+    std::string token;
+    while (iss >> token)
+    {
+        switch (token[0])
+        {
+        case 'R': facing = turn_right(facing); break;
+        case 'L': facing = turn_left(facing); break;
+        case 'U': facing = opposite(facing); break;
+        case 'F':
+            for (long n = std::stol(token.substr(1)); n > 0; --n)
+            {
+                const std::ptrdiff_t next = maze.neighbor(tile, facing);
+                if (next < 0 || !maze.is_open(next))
+                    throw std::runtime_error("Path runs into a wall.");
+                tile = static_cast<std::size_t>(next);
+                maze.map[tile].dir = (dir_e)(facing | (int)dir_e::path);
+            }
+            break;
+        default:
+            throw std::runtime_error("Unknown move: " + token);
+        }
+    }
+
+    if (maze.map[tile].type != tile_e::end)
+        throw std::runtime_error("Path does not end on E.");
+}
@@ -0,0 +1,383 @@
+#pragma once
+
+#include <maze.hpp>
+#include <compact.hpp>
+
+#include <shared_mutex>
+#include <cstring>
+#include <iomanip>
+#include <unordered_map>
+#include <unordered_set>
+
+#if defined(__linux__) || defined(__APPLE__)
+#define MAZE_DAEMON 1
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Long-running solver. Mazes are loaded and pruned once and kept under a name, then any number
+// of clients ask for solves over a local Unix socket. Every query runs maze_t::query() on the
+// shared, read-only maze with the worker's own scratch arena, so a request costs the search
+// and nothing else.
+//
+// Protocol: every message is a frame of a u32 byte count followed by that many bytes. Numbers
+// are in host byte order, the socket never leaves the machine. Strings are a u32 length and
+// the bytes. A request starts with a u8 op, a reply with a u8 status (0 ok, 1 error followed
+// by a message string). A request over max_request_bytes drops the connection.
+//
+//   load     name path   -> key, u32 width, u32 height, u64 pruned tiles
+//                           (an empty name keys the maze by a hash of its file)
+//   solve    key         -> i64 cost, u64 expanded, u64 pushed, u64 microseconds, moves string
+//   unload   key         -> nothing
+//   list                 -> u32 count, keys
+//   shutdown             -> nothing, the daemon stops accepting and exits
+
+enum struct daemon_op_e : u8 { load = 1, solve, unload, list, shutdown };
+
+static constexpr const char* default_socket_path = "/tmp/aoc16.sock";
+
+// Requests only carry names and paths. Replies carry a whole path and aren't capped.
+static constexpr std::uint32_t max_request_bytes = 1u << 16;
+
+// Builds a message body
+struct message_writer_t
+{
+    std::string bytes{};
+
+    template <typename T>
+    message_writer_t& put(T value)
+    {
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        return *this;
+    }
+
+    message_writer_t& put(const std::string& text)
+    {
+        put(static_cast<std::uint32_t>(text.size()));
+        bytes.append(text);
+        return *this;
+    }
+};
+
+// Reads a message body front to back, throwing when it runs short
+struct message_reader_t
+{
+    const std::string& bytes;
+    std::size_t offset{ 0 };
+
+    template <typename T>
+    T get()
+    {
+        if (offset + sizeof(T) > bytes.size())
+            throw std::runtime_error("Truncated message.");
+        T value;
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    std::string get_string()
+    {
+        const std::uint32_t n = get<std::uint32_t>();
+        if (offset + n > bytes.size())
+            throw std::runtime_error("Truncated message.");
+        std::string text = bytes.substr(offset, n);
+        offset += n;
+        return text;
+    }
+};
+
+// FNV-1a, used to key mazes loaded without a name
+static std::string hash_key(const std::string& bytes)
+{
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (char c : bytes)
+    {
+        h ^= static_cast<u8>(c);
+        h *= 0x100000001b3ull;
+    }
+
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << h;
+    return oss.str();
+}
+
+#if MAZE_DAEMON
+static bool send_all(int fd, const char* data, std::size_t n)
+{
+    while (n > 0)
+    {
+#if defined(MSG_NOSIGNAL)
+        const ssize_t sent = ::send(fd, data, n, MSG_NOSIGNAL);
+#else
+        const ssize_t sent = ::send(fd, data, n, 0);
+#endif
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        data += sent;
+        n -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+static bool recv_all(int fd, char* data, std::size_t n)
+{
+    while (n > 0)
+    {
+        const ssize_t got = ::recv(fd, data, n, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        data += got;
+        n -= static_cast<std::size_t>(got);
+    }
+    return true;
+}
+
+static bool send_frame(int fd, const std::string& body)
+{
+    const std::uint32_t n = static_cast<std::uint32_t>(body.size());
+    return send_all(fd, reinterpret_cast<const char*>(&n), sizeof(n)) && send_all(fd, body.data(), body.size());
+}
+
+// False once the peer has closed the connection or announced a frame over max_bytes
+static bool recv_frame(int fd, std::string& body, std::uint32_t max_bytes = std::numeric_limits<std::uint32_t>::max())
+{
+    std::uint32_t n = 0;
+    if (!recv_all(fd, reinterpret_cast<char*>(&n), sizeof(n)) || n > max_bytes)
+        return false;
+    body.resize(n);
+    return n == 0 || recv_all(fd, &body[0], n);
+}
+
+static sockaddr_un socket_address(const std::string& path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::invalid_argument("Socket path is too long.");
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+class solver_daemon_t
+{
+public:
+    solver_daemon_t(const std::string& socket_path, int workers)
+        : m_path(socket_path)
+        , m_workers(std::max(1, workers))
+    {
+    }
+
+    // Serves until a shutdown request arrives. The acceptor runs each connection as a task of a
+    // group on a pool of its own, with one scratch arena per pool thread. Connections block in
+    // recv for as long as a client stays idle, so they get dedicated workers rather than the
+    // shared pool's, which the searches and parsing count on.
+    // Stopping shuts the read side of every open connection, so tasks waiting on an idle
+    // client see it close and the wait below doesn't hang; replies still go out.
+    void run()
+    {
+        m_listen = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_listen < 0)
+            throw std::runtime_error("Failed to create socket.");
+
+        const sockaddr_un addr = socket_address(m_path);
+        ::unlink(m_path.c_str());
+        if (::bind(m_listen, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(m_listen, 64) != 0)
+        {
+            ::close(m_listen);
+            throw std::runtime_error("Failed to listen on " + m_path);
+        }
+        std::cout << "Listening on " << m_path << " with " << m_workers << " workers" << std::endl;
+
+        util::thread_pool_t pool(static_cast<unsigned>(m_workers));
+        std::vector<util::arena_t> scratch(pool.concurrency());
+        util::task_group_t connections(pool);
+
+        while (!m_stop.load(std::memory_order_acquire))
+        {
+            const int fd = ::accept(m_listen, nullptr, nullptr);
+            if (fd >= 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_clients_mutex);
+                    m_clients.insert(fd);
+                }
+                connections.run([this, fd, &pool, &scratch]
+                {
+                    serve(fd, scratch[pool.slot()]);
+                    {
+                        std::lock_guard<std::mutex> lock(m_clients_mutex);
+                        m_clients.erase(fd);
+                    }
+                    ::close(fd);
+                });
+            }
+            else if (errno != EINTR)
+            {
+                break;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_clients_mutex);
+            for (int fd : m_clients)
+                ::shutdown(fd, SHUT_RD);
+        }
+        connections.wait();
+        ::close(m_listen);
+        ::unlink(m_path.c_str());
+    }
+
+private:
+    void serve(int fd, util::arena_t& scratch)
+    {
+        std::string request;
+        while (recv_frame(fd, request, max_request_bytes))
+        {
+            std::string reply;
+            try
+            {
+                reply = handle(request, scratch);
+            }
+            catch (const std::exception& e)
+            {
+                reply = message_writer_t{}.put(u8(1)).put(std::string(e.what())).bytes;
+            }
+
+            if (!send_frame(fd, reply))
+                return;
+        }
+    }
+
+    std::string handle(const std::string& request, util::arena_t& scratch)
+    {
+        message_reader_t in{ request };
+        message_writer_t out{};
+        out.put(u8(0));
+
+        switch (static_cast<daemon_op_e>(in.get<u8>()))
+        {
+        case daemon_op_e::load:
+        {
+            const std::string name = in.get_string();
+            const std::string path = in.get_string();
+            const std::string text = util::read_file_bytes(path.c_str());
+            const std::string key = name.empty() ? hash_key(text) : name;
+
+            // Parsed and pruned outside the lock, so loading never stalls running queries
+            std::shared_ptr<maze_t> maze(new maze_t{});
+            maze->parse(text);
+            maze->prune();
+            {
+                std::unique_lock<std::shared_mutex> lock(m_mutex);
+                m_mazes[key] = maze;
+            }
+            out.put(key).put(static_cast<std::uint32_t>(maze->size.x)).put(static_cast<std::uint32_t>(maze->size.y))
+                .put(static_cast<std::uint64_t>(maze->pruned));
+            break;
+        }
+        case daemon_op_e::solve:
+        {
+            const std::shared_ptr<const maze_t> maze = find(in.get_string());
+            util::stopwatch_t sw{};
+            const solve_result_t result = maze->query(1.0f, scratch);
+            const auto us = sw.elapsed<std::chrono::microseconds>().count();
+            out.put(static_cast<std::int64_t>(result.cost)).put(static_cast<std::uint64_t>(result.expanded))
+                .put(static_cast<std::uint64_t>(result.pushed)).put(static_cast<std::uint64_t>(us))
+                .put(encode_moves(result.path));
+            break;
+        }
+        case daemon_op_e::unload:
+        {
+            const std::string key = in.get_string();
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            if (m_mazes.erase(key) == 0)
+                throw std::invalid_argument("No maze loaded as " + key);
+            break;
+        }
+        case daemon_op_e::list:
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            out.put(static_cast<std::uint32_t>(m_mazes.size()));
+            for (const auto& entry : m_mazes)
+                out.put(entry.first);
+            break;
+        }
+        case daemon_op_e::shutdown:
+        {
+            // Wakes the acceptor, which sees the flag and stops
+            m_stop.store(true, std::memory_order_release);
+            ::shutdown(m_listen, SHUT_RDWR);
+            break;
+        }
+        default:
+            throw std::invalid_argument("Unknown request.");
+        }
+
+        return out.bytes;
+    }
+
+    // Queries hold their own reference, so an unload mid-query frees the maze afterwards
+    std::shared_ptr<const maze_t> find(const std::string& key) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        const auto it = m_mazes.find(key);
+        if (it == m_mazes.end())
+            throw std::invalid_argument("No maze loaded as " + key);
+        return it->second;
+    }
+
+    std::string m_path;
+    int m_workers{ 1 };
+    int m_listen{ -1 };
+    std::atomic<bool> m_stop{ false };
+    std::mutex m_clients_mutex{};
+    std::unordered_set<int> m_clients{};    // Accepted connections not yet closed
+    mutable std::shared_mutex m_mutex{};
+    std::unordered_map<std::string, std::shared_ptr<maze_t>> m_mazes{};
+};
+
+// Client side: one connection, one request and reply at a time
+class daemon_client_t
+{
+public:
+    explicit daemon_client_t(const std::string& socket_path)
+    {
+        m_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        const sockaddr_un addr = socket_address(socket_path);
+        if (m_fd < 0 || ::connect(m_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            if (m_fd >= 0)
+                ::close(m_fd);
+            throw std::runtime_error("Failed to connect to " + socket_path);
+        }
+    }
+
+    ~daemon_client_t() { ::close(m_fd); }
+
+    daemon_client_t(const daemon_client_t&) = delete;
+    daemon_client_t& operator=(const daemon_client_t&) = delete;
+
+    // Sends a request body and returns the reply with its status already checked
+    std::string call(const message_writer_t& request)
+    {
+        std::string reply;
+        if (!send_frame(m_fd, request.bytes) || !recv_frame(m_fd, reply))
+            throw std::runtime_error("Lost connection to the daemon.");
+
+        message_reader_t in{ reply };
+        if (in.get<u8>() != 0)
+            throw std::runtime_error(in.get_string());
+        return reply.substr(1);
+    }
+
+private:
+    int m_fd{ -1 };
+};
+#endif
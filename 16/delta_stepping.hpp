@@ -0,0 +1,261 @@
+#pragma once
+
+#include <maze.hpp>
+
+#include <atomic>
+
+// Δ-stepping over the (tile, facing) graph. Tentative distances are bucketed by width Δ.
+// Each bucket is settled in phases: light edges (cost <= Δ) are relaxed until the bucket
+// stops changing, then the heavy edges of everything it settled are relaxed once. Relaxations
+// inside a phase run on the thread pool and meet through an atomic min on the distance array.
+// With the default Δ = turn_cost every straight move is light and every turn is heavy.
+class delta_stepping_t
+{
+public:
+    // threads = 0 runs on the shared pool, anything else on a private pool of that many threads
+    explicit delta_stepping_t(maze_t& maze, int threads = 0, cost_t delta = turn_cost)
+        : m_maze(maze)
+        , m_own_pool(threads > 0 ? new util::thread_pool_t(threads - 1) : nullptr)
+        , m_pool(m_own_pool ? *m_own_pool : util::thread_pool_t::shared())
+        , m_delta(std::max<cost_t>(1, delta))
+    {
+    }
+
+    // Returns the path cost or -1 when E is unreachable
+    cost_t solve()
+    {
+        if (m_maze.start_idx == maze_t::npos || m_maze.end_idx == maze_t::npos)
+            throw std::runtime_error("Maze must have a start (S) and an end (E).");
+
+        util::stopwatch_t sw{};
+        if (!m_maze.connected(m_maze.start_idx, m_maze.end_idx))
+        {
+            m_relaxed = 0;
+            m_cost = -1;
+            m_solve_time = sw.elapsed_ms();
+            return m_cost;
+        }
+        reset();
+
+        const std::size_t start = state_id(m_maze.start_idx, (int)dir_e::e);
+        m_dist[start].store(0, std::memory_order_relaxed);
+        m_local[0].buckets[0].push_back(start);
+
+        cost_t best = infinite_cost;
+        for (std::size_t bucket = 0; ; ++bucket)
+        {
+            // Everything below this bucket is settled, so a goal reached below it is final
+            best = goal_distance();
+            if (best < (cost_t)bucket * m_delta)
+                break;
+
+            if (!any_pending())
+                break;
+
+            const std::size_t slot = bucket % m_slots;
+            m_settled.clear();
+
+            // Light phases until the bucket stays empty
+            while (gather(slot))
+            {
+                m_bucket = bucket;
+                run_phase(false);
+                for (auto& l : m_local)
+                {
+                    m_settled.insert(m_settled.end(), l.settled.begin(), l.settled.end());
+                    l.settled.clear();
+                }
+            }
+
+            // One heavy phase over everything the bucket settled
+            m_frontier.swap(m_settled);
+            run_phase(true);
+        }
+
+        m_cost = best >= infinite_cost ? -1 : best;
+        m_solve_time = sw.elapsed_ms();
+        return m_cost;
+    }
+
+    // Rebuilds the path from the distance field and copies the result into the maze
+    void mark_path() const
+    {
+        for (std::size_t i = 0; i < m_maze.capacity(); ++i)
+            m_maze.map[i].dir = dir_e::none;
+
+        m_maze.path_cost = m_cost;
+        m_maze.path_bound = 1.0f;
+        m_maze.search_count = static_cast<int>(m_relaxed);
+        m_maze.solve_time = m_solve_time;
+        if (m_cost < 0)
+            return;
+
+        std::vector<state_t> states(m_dist.size());
+        std::size_t goal = 0;
+        for (int f = 0; f < facings; ++f)
+        {
+            const std::size_t s = state_id(m_maze.end_idx, f);
+            if (m_dist[s].load(std::memory_order_relaxed) == m_cost)
+                goal = s;
+        }
+
+        // Walk back through predecessors whose distance explains the current one
+        std::size_t u = goal;
+        const std::size_t start = state_id(m_maze.start_idx, (int)dir_e::e);
+        states[start].p_idx = start;
+        while (u != start)
+        {
+            const int d = state_facing(u);
+            const std::ptrdiff_t p = m_maze.neighbor(state_tile(u), opposite(d));
+            const cost_t du = m_dist[u].load(std::memory_order_relaxed);
+            for (int f = 0; f < facings; ++f)
+            {
+                const std::size_t ps = state_id(p, f);
+                if (m_dist[ps].load(std::memory_order_relaxed) + move_cost(f, d) == du)
+                {
+                    states[u].p_idx = ps;
+                    u = ps;
+                    break;
+                }
+            }
+        }
+
+        m_maze.mark_path(states.data(), goal);
+    }
+
+    std::size_t relaxed() const { return m_relaxed; }
+    unsigned threads() const { return m_pool.concurrency(); }
+
+private:
+    // Frontiers smaller than this are relaxed on the calling thread alone
+    static constexpr std::size_t parallel_threshold = 512;
+    static constexpr std::size_t chunk = 256;
+
+    struct local_t
+    {
+        std::vector<std::vector<std::size_t>> buckets{};
+        std::vector<std::size_t> settled{};
+        std::size_t relaxed{ 0 };
+    };
+
+    void reset()
+    {
+        m_dist = std::vector<std::atomic<cost_t>>(m_maze.capacity() * facings);
+        for (auto& d : m_dist)
+            d.store(infinite_cost, std::memory_order_relaxed);
+
+        // A relaxation lands at most max_edge / Δ buckets ahead, so a ring of slots is enough
+        m_slots = static_cast<std::size_t>((step_cost + turn_cost) / m_delta) + 2;
+        m_local.assign(m_pool.concurrency(), local_t{});
+        for (auto& l : m_local)
+            l.buckets.assign(m_slots, std::vector<std::size_t>{});
+
+        m_frontier.clear();
+        m_settled.clear();
+        m_relaxed = 0;
+        m_cost = -1;
+    }
+
+    cost_t goal_distance() const
+    {
+        cost_t best = infinite_cost;
+        for (int f = 0; f < facings; ++f)
+            best = std::min(best, m_dist[state_id(m_maze.end_idx, f)].load(std::memory_order_relaxed));
+        return best;
+    }
+
+    bool any_pending() const
+    {
+        for (const auto& l : m_local)
+            for (const auto& b : l.buckets)
+                if (!b.empty())
+                    return true;
+        return false;
+    }
+
+    // Moves the current bucket from every thread into the shared frontier
+    bool gather(std::size_t slot)
+    {
+        m_frontier.clear();
+        for (auto& l : m_local)
+        {
+            m_frontier.insert(m_frontier.end(), l.buckets[slot].begin(), l.buckets[slot].end());
+            l.buckets[slot].clear();
+        }
+        return !m_frontier.empty();
+    }
+
+    inline bool relax(std::size_t v, cost_t nd)
+    {
+        cost_t old = m_dist[v].load(std::memory_order_relaxed);
+        while (nd < old)
+        {
+            if (m_dist[v].compare_exchange_weak(old, nd, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    // Relaxes the light or heavy edges of one frontier state
+    void expand(std::size_t u, bool heavy, local_t& local)
+    {
+        const cost_t du = m_dist[u].load(std::memory_order_relaxed);
+        if (!heavy)
+        {
+            // Stale entries were improved into an earlier bucket and already handled there
+            if (du / m_delta != (cost_t)m_bucket)
+                return;
+            local.settled.push_back(u);
+        }
+
+        const std::size_t tile = state_tile(u);
+        const int facing = state_facing(u);
+        for (unsigned exits = m_maze.map[tile].exits; exits != 0; exits &= exits - 1)
+        {
+            const int d = util::count_trailing_zeros(exits);
+            const cost_t c = move_cost(facing, d);
+            if ((c > m_delta) != heavy)
+                continue;
+
+            const std::size_t v = state_id(m_maze.step(tile, d), d);
+            const cost_t nd = du + c;
+            ++local.relaxed;
+            if (relax(v, nd))
+                local.buckets[(nd / m_delta) % m_slots].push_back(v);
+        }
+    }
+
+    void run_phase(bool heavy)
+    {
+        const std::size_t grain = m_frontier.size() < parallel_threshold ? m_frontier.size() : chunk;
+        util::parallel_for(m_pool, 0, m_frontier.size(), grain, [&](std::size_t begin, std::size_t end)
+        {
+            // Only this solve's caller and the pool's workers run its tasks, so slots are unique
+            local_t& local = m_local[m_pool.slot()];
+            for (std::size_t i = begin; i < end; ++i)
+                expand(m_frontier[i], heavy, local);
+        });
+
+        for (auto& l : m_local)
+        {
+            m_relaxed += l.relaxed;
+            l.relaxed = 0;
+        }
+    }
+
+    maze_t& m_maze;
+    std::unique_ptr<util::thread_pool_t> m_own_pool;
+    util::thread_pool_t& m_pool;
+    cost_t m_delta{ turn_cost };
+    std::size_t m_slots{ 0 };
+
+    std::vector<std::atomic<cost_t>> m_dist{};
+    std::vector<local_t> m_local{};
+    std::vector<std::size_t> m_frontier{};
+    std::vector<std::size_t> m_settled{};
+    std::size_t m_bucket{ 0 };
+
+    std::size_t m_relaxed{ 0 };
+    cost_t m_cost{ -1 };
+    int m_solve_time{ 0 };
+};
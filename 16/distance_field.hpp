@@ -0,0 +1,261 @@
+#pragma once
+
+#include <maze.hpp>
+
+#include <cstring>
+
+// The exact cost from every (tile, facing) state to E, found once by a backward Dijkstra from
+// every facing on E. After that the optimal cost from any start and facing is one lookup, and
+// the path is a greedy descent: from each state take a move whose cost plus the next state's
+// distance equals this one's. Nothing is searched, so queries that share E cost microseconds.
+//
+// Costs follow the puzzle's model. The field only holds for the walls and E it was built on,
+// edits afterwards need a rebuild. It steps through every tile that isn't a wall, dead ones
+// included, so a pruned maze gets the same field and a start inside a filled dead end still
+// has its cost.
+//
+// A saved field is a 64 byte header followed by the distances, one i64 per state in the
+// maze's own state order, -1 where E can't be reached. The header holds a hash of where the
+// walls are, so a field saved before walls changed is not mistaken for this maze's.
+class distance_field_t
+{
+public:
+    static constexpr std::size_t header_bytes = 64;
+
+    struct header_t
+    {
+        char magic[4];
+        std::int32_t width, height;
+        std::int32_t layout;
+        std::int32_t end_x, end_y;
+        std::uint64_t states;
+        std::uint64_t grid_hash;
+    };
+
+    explicit distance_field_t(const maze_t& maze)
+        : m_maze(maze)
+    {
+    }
+
+    // Every state's distance to E. The backward search steps from a state to the tile behind
+    // it, through any facing that tile could have been left with. Keys never drop, so the
+    // open list is a radix heap.
+    void build()
+    {
+        util::stopwatch_t sw{};
+        if (m_maze.end_idx == maze_t::npos)
+            throw std::runtime_error("Maze must have an end (E).");
+
+        const std::size_t states = m_maze.capacity() * facings;
+        m_dist.resize(states);
+        util::parallel_for(0, states, std::size_t(1) << 16, [&](std::size_t begin, std::size_t end)
+        {
+            std::fill(m_dist.begin() + begin, m_dist.begin() + end, infinite_cost);
+        });
+
+        struct entry_t
+        {
+            cost_t g;
+            std::size_t state;
+            inline cost_t key() const { return g; }
+        };
+        util::arena_t scratch{};
+        radix_heap_t<entry_t> open(scratch);
+        for (int f = 0; f < facings; ++f)
+        {
+            m_dist[state_id(m_maze.end_idx, f)] = 0;
+            open.push(entry_t{ 0, state_id(m_maze.end_idx, f) });
+        }
+
+        while (!open.empty())
+        {
+            const entry_t top = open.top();
+            open.pop();
+            if (top.g > m_dist[top.state])
+                continue;
+
+            // Arriving facing d means the previous tile lies behind us
+            const std::size_t tile = state_tile(top.state);
+            const int d = state_facing(top.state);
+            if ((passable(tile) & (1u << opposite(d))) == 0)
+                continue;
+
+            const std::size_t prev = m_maze.step(tile, opposite(d));
+            for (int f = 0; f < facings; ++f)
+            {
+                const std::size_t s = state_id(prev, f);
+                const cost_t g = top.g + move_cost(f, d);
+                if (g < m_dist[s])
+                {
+                    m_dist[s] = g;
+                    open.push(entry_t{ g, s });
+                }
+            }
+        }
+
+        m_build_time = sw.elapsed_ms();
+    }
+
+    // Optimal cost from the tile facing this way, -1 when E is unreachable from it
+    inline cost_t cost(std::size_t tile, int facing) const
+    {
+        const cost_t d = m_dist[state_id(tile, facing)];
+        return d >= infinite_cost ? -1 : d;
+    }
+
+    // The optimal path by descent, with the same fields a search would fill
+    solve_result_t answer(std::size_t tile, int facing) const
+    {
+        util::stopwatch_t sw{};
+        solve_result_t result{};
+        result.cost = cost(tile, facing);
+        if (!result.found())
+        {
+            result.solve_time = sw.elapsed_ms();
+            return result;
+        }
+
+        std::size_t s = state_id(tile, facing);
+        result.path.push_back(s);
+        while (state_tile(s) != m_maze.end_idx)
+        {
+            const std::size_t t = state_tile(s);
+            const int f = state_facing(s);
+            std::size_t next = s;
+            for (unsigned exits = passable(t); exits != 0 && next == s; exits &= exits - 1)
+            {
+                const int d = util::count_trailing_zeros(exits);
+                const std::size_t n = state_id(m_maze.step(t, d), d);
+                if (m_dist[n] + move_cost(f, d) == m_dist[s])
+                    next = n;
+            }
+
+            if (next == s)
+                throw std::runtime_error("Distance field doesn't match the maze.");
+            s = next;
+            result.path.push_back(s);
+            ++result.expanded;
+        }
+
+        result.pushed = result.path.size();
+        result.solve_time = sw.elapsed_ms();
+        return result;
+    }
+
+    void save(const char* filepath) const
+    {
+        std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            throw std::runtime_error("Failed to open file for writing.");
+
+        char bytes[header_bytes] = {};
+        const header_t header = make_header();
+        std::memcpy(bytes, &header, sizeof(header));
+        out.write(bytes, header_bytes);
+
+        // Unreachable states as -1 on disk, so the file doesn't depend on infinite_cost
+        std::vector<cost_t> block;
+        const std::size_t block_states = std::size_t(1) << 16;
+        for (std::size_t begin = 0; begin < m_dist.size(); begin += block_states)
+        {
+            const std::size_t end = std::min(m_dist.size(), begin + block_states);
+            block.assign(m_dist.begin() + begin, m_dist.begin() + end);
+            for (cost_t& d : block)
+                d = d >= infinite_cost ? -1 : d;
+            out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(cost_t)));
+        }
+
+        if (!out)
+            throw std::runtime_error("Failed to write to file.");
+    }
+
+    // Reads a field saved for this maze. False, with the field left as it was, when the file
+    // isn't a field or was built for another grid, E or layout; the caller rebuilds then.
+    bool load(const char* filepath)
+    {
+        util::stopwatch_t sw{};
+        std::ifstream in(filepath, std::ios::binary | std::ios::ate);
+        if (!in.is_open())
+            throw std::runtime_error("Failed to open file.");
+        const std::size_t file_bytes = static_cast<std::size_t>(in.tellg());
+        in.seekg(0);
+
+        char bytes[header_bytes] = {};
+        header_t header{};
+        if (file_bytes < header_bytes || !in.read(bytes, header_bytes))
+            return false;
+        std::memcpy(&header, bytes, sizeof(header));
+
+        const header_t expected = make_header();
+        if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+            header.width != expected.width || header.height != expected.height || header.layout != expected.layout ||
+            header.end_x != expected.end_x || header.end_y != expected.end_y || header.states != expected.states ||
+            header.grid_hash != expected.grid_hash || file_bytes != header_bytes + header.states * sizeof(cost_t))
+            return false;
+
+        // Straight into the distances, the file is as large as the field
+        std::vector<cost_t> dist(header.states);
+        if (!in.read(reinterpret_cast<char*>(dist.data()), static_cast<std::streamsize>(dist.size() * sizeof(cost_t))))
+            throw std::runtime_error("Failed to read file.");
+        util::parallel_for(0, dist.size(), std::size_t(1) << 16, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t s = begin; s < end; ++s)
+                dist[s] = dist[s] < 0 ? infinite_cost : dist[s];
+        });
+
+        m_dist.swap(dist);
+        m_build_time = sw.elapsed_ms();
+        return true;
+    }
+
+    inline std::size_t bytes() const { return m_dist.size() * sizeof(cost_t); }
+    inline int build_time() const { return m_build_time; }
+
+private:
+    header_t make_header() const
+    {
+        const ivec2 end = m_maze.end_idx != maze_t::npos ? m_maze.map[m_maze.end_idx].pos : ivec2{ -1, -1 };
+        return header_t{ { 'M', 'Z', 'D', '2' }, m_maze.size.x, m_maze.size.y, (std::int32_t)m_maze.layout.kind,
+            end.x, end.y, (std::uint64_t)m_maze.capacity() * facings, grid_hash() };
+    }
+
+    // Directions out of a tile to neighbours that aren't walls. The maze's own exits leave out
+    // dead tiles, which the field walks through.
+    inline unsigned passable(std::size_t tile) const
+    {
+        unsigned exits = 0;
+        for (int d = 0; d < 4; ++d)
+        {
+            const std::ptrdiff_t n = m_maze.neighbor(tile, d);
+            exits |= (n >= 0 && m_maze.map[n].type != tile_e::wall) ? 1u << d : 0u;
+        }
+        return exits;
+    }
+
+    // FNV-1a over which tiles are walls, a chunk per task and the chunk hashes folded in order,
+    // so the result doesn't depend on the thread count or on pruning
+    std::uint64_t grid_hash() const
+    {
+        const std::size_t grain = std::size_t(1) << 16;
+        const std::size_t tiles = m_maze.capacity();
+        std::vector<std::uint64_t> chunks((tiles + grain - 1) / grain);
+        util::parallel_for(0, tiles, grain, [&](std::size_t begin, std::size_t end)
+        {
+            std::uint64_t h = 0xcbf29ce484222325ull;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                h = (h ^ (m_maze.map[i].type == tile_e::wall ? 1u : 0u)) * 0x100000001b3ull;
+            }
+            chunks[begin / grain] = h;
+        });
+
+        std::uint64_t h = 0xcbf29ce484222325ull;
+        for (std::uint64_t c : chunks)
+            h = (h ^ c) * 0x100000001b3ull;
+        return h;
+    }
+
+    const maze_t& m_maze;
+    std::vector<cost_t> m_dist{};
+    int m_build_time{ 0 };
+};
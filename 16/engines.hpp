@@ -0,0 +1,73 @@
+#pragma once
+
+#include <lpa.hpp>
+#include <ara.hpp>
+#include <delta_stepping.hpp>
+#include <hda.hpp>
+#include <hpa.hpp>
+
+// Every exact engine behind one signature. run() solves the loaded maze and leaves the result
+// in it (path_cost, search_count, solve_time and the marked path) so print() works unchanged.
+struct engine_t
+{
+    const char* name;
+    bool parallel;
+    void (*run)(maze_t& maze, int threads);
+};
+
+static const std::vector<engine_t>& engines()
+{
+    static const std::vector<engine_t> list =
+    {
+        { "astar", false, [](maze_t& maze, int)
+            {
+                maze.solve();
+            }
+        },
+        { "lpa", false, [](maze_t& maze, int)
+            {
+                incremental_solver_t solver(maze);
+                solver.solve();
+                solver.mark_path();
+            }
+        },
+        { "ara", false, [](maze_t& maze, int)
+            {
+                anytime_solver_t solver(maze);
+                util::stopwatch_t sw{};
+                const anytime_report_t result = solver.solve(3.0f, 0.5f, std::numeric_limits<int>::max());
+                solver.mark_path(result, sw.elapsed_ms());
+            }
+        },
+        { "delta", true, [](maze_t& maze, int threads)
+            {
+                delta_stepping_t solver(maze, threads);
+                solver.solve();
+                solver.mark_path();
+            }
+        },
+        { "hda", true, [](maze_t& maze, int threads)
+            {
+                hda_solver_t solver(maze, threads);
+                solver.solve();
+                solver.mark_path();
+            }
+        },
+        { "hpa", false, [](maze_t& maze, int)
+            {
+                hpa_solver_t solver(maze);
+                solver.solve();
+                solver.mark_path();
+            }
+        },
+    };
+    return list;
+}
+
+static const engine_t& find_engine(const std::string& name)
+{
+    for (const auto& e : engines())
+        if (name == e.name)
+            return e;
+    throw std::invalid_argument("Unknown engine: " + name);
+}
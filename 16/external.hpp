@@ -0,0 +1,649 @@
+#pragma once
+
+#include <maze.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+// Out-of-core solving for mazes that don't fit in memory as tile_t. The text is converted once
+// into a grid file holding one bit per tile, which is then memory-mapped, and the search state
+// lives in a fixed number of in-memory blocks that spill to a scratch file. Both are cut into
+// the same 64x64 tile blocks, so a search that wanders through the maze reads and writes whole
+// blocks in a predictable pattern instead of faulting single pages.
+
+// A grid file: a 64 byte header, then one 512 byte block per 64x64 tiles in row-major block
+// order. Each block is 64 rows of one 64-bit word, bit x set when the tile is open.
+class external_grid_t
+{
+public:
+    static constexpr int block_shift = 6;
+    static constexpr int block_mask = (1 << block_shift) - 1;
+    static constexpr std::size_t block_tiles = std::size_t(1) << (2 * block_shift);
+    static constexpr std::size_t header_bytes = 64;
+
+    struct header_t
+    {
+        char magic[4];
+        std::int32_t width, height;
+        std::int32_t start_x, start_y;
+        std::int32_t end_x, end_y;
+    };
+
+    // Streams a text maze into a grid file one band of 64 rows at a time, so converting
+    // never holds more than a band of the maze in memory
+    static void convert(const char* text_path, const char* grid_path)
+    {
+        std::ifstream in(text_path, std::ios::binary);
+        if (!in.is_open())
+            throw std::runtime_error("Failed to open file.");
+        std::ofstream out(grid_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            throw std::runtime_error("Failed to open file for writing.");
+
+        header_t header{ { 'M', 'Z', 'G', '1' }, 0, 0, -1, -1, -1, -1 };
+        const std::string zeros(header_bytes, '\0');
+        out.write(zeros.data(), header_bytes);
+
+        std::string line;
+        std::vector<u8> codes;
+        std::vector<std::uint64_t> band;
+        int blocks_x = 0;
+        int y = 0;
+
+        auto flush = [&]()
+        {
+            out.write(reinterpret_cast<const char*>(band.data()), static_cast<std::streamsize>(band.size() * sizeof(std::uint64_t)));
+            std::fill(band.begin(), band.end(), 0);
+        };
+
+        while (std::getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty())
+                continue;
+
+            if (y == 0)
+            {
+                header.width = static_cast<std::int32_t>(line.size());
+                blocks_x = (header.width + block_mask) >> block_shift;
+                band.assign((std::size_t)blocks_x << block_shift, 0);
+            }
+            else if (line.size() != static_cast<std::size_t>(header.width))
+            {
+                throw std::runtime_error("Inconsistent row lengths in maze file.");
+            }
+
+            codes.resize(line.size());
+            scan_result_t scan{};
+            maze_t::classify(line.data(), line.size(), codes.data(), scan);
+            if (scan.invalid != scan_result_t::npos)
+                throw std::invalid_argument("Invalid character in maze file.");
+            if (scan.start != scan_result_t::npos && header.start_x < 0) { header.start_x = (std::int32_t)scan.start; header.start_y = y; }
+            if (scan.end != scan_result_t::npos && header.end_x < 0) { header.end_x = (std::int32_t)scan.end; header.end_y = y; }
+
+            const int row = y & block_mask;
+            for (int x = 0; x < header.width; ++x)
+            {
+                if (codes[x] != static_cast<u8>(tile_e::wall))
+                    band[((std::size_t)(x >> block_shift) << block_shift) + row] |= std::uint64_t(1) << (x & block_mask);
+            }
+
+            if (row == block_mask)
+                flush();
+            ++y;
+        }
+
+        if (y == 0)
+            throw std::runtime_error("File is empty.");
+        if (y & block_mask)
+            flush();
+
+        header.height = y;
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!out)
+            throw std::runtime_error("Failed to write to file.");
+    }
+
+    explicit external_grid_t(const char* grid_path)
+        : m_file(grid_path)
+    {
+        if (m_file.size() < header_bytes)
+            throw std::runtime_error("Not a grid file.");
+
+        std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+        if (std::memcmp(m_header.magic, "MZG1", 4) != 0)
+            throw std::runtime_error("Not a grid file.");
+
+        m_blocks_x = (m_header.width + block_mask) >> block_shift;
+        m_blocks_y = (m_header.height + block_mask) >> block_shift;
+        if (m_file.size() < header_bytes + blocks() * block_tiles / 8)
+            throw std::runtime_error("Grid file is truncated.");
+        m_bits = reinterpret_cast<const std::uint64_t*>(m_file.data() + header_bytes);
+    }
+
+    inline ivec2 size() const { return ivec2{ m_header.width, m_header.height }; }
+    inline ivec2 start() const { return ivec2{ m_header.start_x, m_header.start_y }; }
+    inline ivec2 end() const { return ivec2{ m_header.end_x, m_header.end_y }; }
+    inline std::size_t blocks() const { return (std::size_t)m_blocks_x * m_blocks_y; }
+
+    inline std::size_t block_of(int x, int y) const
+    {
+        return (std::size_t)(y >> block_shift) * m_blocks_x + (x >> block_shift);
+    }
+
+    inline std::size_t local(int x, int y) const
+    {
+        return ((std::size_t)(y & block_mask) << block_shift) | (std::size_t)(x & block_mask);
+    }
+
+    // Outside the grid counts as a wall
+    inline bool is_open(int x, int y) const
+    {
+        if (x < 0 || x >= m_header.width || y < 0 || y >= m_header.height)
+            return false;
+        return (m_bits[(block_of(x, y) << block_shift) + (y & block_mask)] >> (x & block_mask)) & 1;
+    }
+
+private:
+    util::mapped_file_t m_file;
+    header_t m_header{};
+    const std::uint64_t* m_bits{ nullptr };
+    int m_blocks_x{ 0 };
+    int m_blocks_y{ 0 };
+};
+
+// g-costs for every (tile, facing), one block of 64x64 tiles at a time. A fixed number of
+// blocks stay in memory; the clock algorithm picks a victim when a missing block is needed,
+// and dirty victims are written back to their slot in the scratch file. Blocks never written
+// read back as unvisited.
+class state_cache_t
+{
+public:
+    static constexpr std::size_t block_states = external_grid_t::block_tiles * facings;
+    static constexpr std::size_t block_bytes = block_states * sizeof(cost_t);
+
+    state_cache_t(const std::string& scratch_path, std::size_t blocks, std::size_t budget_bytes)
+        : m_path(scratch_path)
+        , m_slot_of(blocks, none)
+        , m_stored(blocks, false)
+    {
+        const std::size_t slots = std::max<std::size_t>(2, std::min(blocks, budget_bytes / block_bytes));
+        m_slots.resize(slots);
+        m_data.resize(slots * block_states);
+
+        m_file.open(scratch_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!m_file.is_open())
+            throw std::runtime_error("Failed to open scratch file.");
+    }
+
+    ~state_cache_t()
+    {
+        m_file.close();
+        std::remove(m_path.c_str());
+    }
+
+    state_cache_t(const state_cache_t&) = delete;
+    state_cache_t& operator=(const state_cache_t&) = delete;
+
+    // The facings of one tile. Valid until the next call, which may evict the block.
+    inline cost_t* tile(std::size_t block, std::size_t local, bool dirty)
+    {
+        const std::uint32_t s = acquire(block);
+        m_slots[s].dirty |= dirty;
+        return &m_data[(std::size_t)s * block_states + local * facings];
+    }
+
+    inline std::size_t resident() const { return m_slots.size(); }
+    inline std::size_t reads() const { return m_reads; }
+    inline std::size_t writes() const { return m_writes; }
+
+private:
+    static constexpr std::uint32_t none = static_cast<std::uint32_t>(-1);
+
+    struct slot_t
+    {
+        std::size_t block{ static_cast<std::size_t>(-1) };
+        bool referenced{ false };
+        bool dirty{ false };
+    };
+
+    std::uint32_t acquire(std::size_t block)
+    {
+        const std::uint32_t hit = m_slot_of[block];
+        if (hit != none)
+        {
+            m_slots[hit].referenced = true;
+            return hit;
+        }
+
+        // Sweep the clock hand past recently used blocks
+        while (m_slots[m_hand].referenced)
+        {
+            m_slots[m_hand].referenced = false;
+            m_hand = (m_hand + 1) % m_slots.size();
+        }
+
+        const std::uint32_t s = m_hand;
+        m_hand = (m_hand + 1) % m_slots.size();
+        slot_t& slot = m_slots[s];
+        cost_t* data = &m_data[(std::size_t)s * block_states];
+
+        if (slot.block != static_cast<std::size_t>(-1))
+        {
+            if (slot.dirty)
+            {
+                m_file.seekp(static_cast<std::streamoff>(slot.block * block_bytes));
+                m_file.write(reinterpret_cast<const char*>(data), block_bytes);
+                if (!m_file)
+                    throw std::runtime_error("Failed to write search state.");
+                m_stored[slot.block] = true;
+                ++m_writes;
+            }
+            m_slot_of[slot.block] = none;
+        }
+
+        if (m_stored[block])
+        {
+            m_file.seekg(static_cast<std::streamoff>(block * block_bytes));
+            m_file.read(reinterpret_cast<char*>(data), block_bytes);
+            if (!m_file)
+                throw std::runtime_error("Failed to read search state.");
+            ++m_reads;
+        }
+        else
+        {
+            std::fill(data, data + block_states, infinite_cost);
+        }
+
+        slot = slot_t{ block, true, false };
+        m_slot_of[block] = s;
+        return s;
+    }
+
+    std::string m_path;
+    std::fstream m_file;
+    std::vector<slot_t> m_slots;
+    std::vector<cost_t> m_data;
+    std::vector<std::uint32_t> m_slot_of;
+    std::vector<bool> m_stored;
+    std::size_t m_hand{ 0 };
+    std::size_t m_reads{ 0 };
+    std::size_t m_writes{ 0 };
+};
+
+// The external solver's open list. Entries with f below a threshold sit in an in-memory heap,
+// the rest are appended unsorted to a scratch file. When the heap outgrows its budget the
+// threshold drops to the heap's median f and everything at or above it moves to the file.
+// When the heap runs dry the file is scanned for the lowest f values that fit the budget,
+// those come back and the rest are rewritten. The heap and the file never hold the same f,
+// so the heap's top is always the smallest entry.
+template <typename Entry>
+class spill_open_list_t
+{
+public:
+    spill_open_list_t(const std::string& scratch_path, std::size_t budget_bytes)
+        : m_path(scratch_path)
+        , m_capacity(std::max<std::size_t>(1024, budget_bytes / sizeof(Entry)))
+    {
+        m_file.open(m_path, std::ios::binary | std::ios::trunc);
+        if (!m_file.is_open())
+            throw std::runtime_error("Failed to open scratch file.");
+    }
+
+    ~spill_open_list_t()
+    {
+        m_file.close();
+        std::remove(m_path.c_str());
+    }
+
+    spill_open_list_t(const spill_open_list_t&) = delete;
+    spill_open_list_t& operator=(const spill_open_list_t&) = delete;
+
+    void push(const Entry& e)
+    {
+        if (e.f >= m_threshold)
+        {
+            write(&e, 1);
+            ++m_stored;
+            return;
+        }
+
+        m_heap.push_back(e);
+        std::push_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+        if (m_heap.size() > m_capacity)
+            spill();
+    }
+
+    // Reloads from the file when the heap is empty, so call it before pop()
+    const Entry& top()
+    {
+        if (m_heap.empty())
+            reload();
+        return m_heap.front();
+    }
+
+    void pop()
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+        m_heap.pop_back();
+    }
+
+    void clear()
+    {
+        m_heap.clear();
+        m_stored = 0;
+        m_spills = 0;
+        m_threshold = infinite_cost;
+        m_file.close();
+        m_file.open(m_path, std::ios::binary | std::ios::trunc);
+        if (!m_file.is_open())
+            throw std::runtime_error("Failed to open scratch file.");
+    }
+
+    inline bool empty() const { return m_heap.empty() && m_stored == 0; }
+    inline std::size_t size() const { return m_heap.size() + m_stored; }
+    inline std::size_t spills() const { return m_spills; }
+
+private:
+    static constexpr std::size_t chunk_entries = 4096;
+
+    void write(const Entry* entries, std::size_t n)
+    {
+        m_file.write(reinterpret_cast<const char*>(entries), static_cast<std::streamsize>(n * sizeof(Entry)));
+        if (!m_file)
+            throw std::runtime_error("Failed to write open list.");
+    }
+
+    // Moves the upper half of the heap by f to the file. A heap of one f stays in memory and
+    // the budget doubles, since splitting it would put the same f on both sides.
+    void spill()
+    {
+        const auto mid = m_heap.begin() + m_heap.size() / 2;
+        std::nth_element(m_heap.begin(), mid, m_heap.end(), [](const Entry& a, const Entry& b) { return a.f < b.f; });
+        const cost_t lowest = std::min_element(m_heap.begin(), mid + 1, [](const Entry& a, const Entry& b) { return a.f < b.f; })->f;
+        m_threshold = std::max(mid->f, lowest + 1);
+
+        const auto kept = std::partition(m_heap.begin(), m_heap.end(), [this](const Entry& e) { return e.f < m_threshold; });
+        const std::size_t moved = static_cast<std::size_t>(m_heap.end() - kept);
+        if (moved > 0)
+            write(&*kept, moved);
+        else
+            m_capacity *= 2;
+        m_stored += moved;
+        m_heap.erase(kept, m_heap.end());
+        std::make_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+        ++m_spills;
+    }
+
+    // Brings back the lowest f values that fit, at least one f even when it alone is over
+    void reload()
+    {
+        m_file.close();
+        std::vector<Entry> chunk(chunk_entries);
+        std::map<cost_t, std::size_t> counts;
+        for_each_chunk(chunk, [&](std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+                ++counts[chunk[i].f];
+        });
+
+        std::size_t taken = 0;
+        m_threshold = infinite_cost;
+        for (const auto& c : counts)
+        {
+            if (taken > 0 && taken + c.second > m_capacity)
+            {
+                m_threshold = c.first;
+                break;
+            }
+            taken += c.second;
+        }
+
+        const std::string rest_path = m_path + ".rest";
+        std::ofstream rest(rest_path, std::ios::binary | std::ios::trunc);
+        for_each_chunk(chunk, [&](std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (chunk[i].f < m_threshold)
+                    m_heap.push_back(chunk[i]);
+                else
+                    rest.write(reinterpret_cast<const char*>(&chunk[i]), sizeof(Entry));
+            }
+        });
+        rest.close();
+        if (!rest || std::rename(rest_path.c_str(), m_path.c_str()) != 0)
+            throw std::runtime_error("Failed to write open list.");
+
+        m_stored -= m_heap.size();
+        std::make_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+        m_file.open(m_path, std::ios::binary | std::ios::app);
+        if (!m_file.is_open())
+            throw std::runtime_error("Failed to open scratch file.");
+    }
+
+    template <typename Fn>
+    void for_each_chunk(std::vector<Entry>& chunk, Fn&& fn) const
+    {
+        std::ifstream in(m_path, std::ios::binary);
+        if (!in.is_open())
+            throw std::runtime_error("Failed to read open list.");
+        while (in)
+        {
+            in.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(chunk.size() * sizeof(Entry)));
+            const std::size_t n = static_cast<std::size_t>(in.gcount()) / sizeof(Entry);
+            if (n > 0)
+                fn(n);
+        }
+    }
+
+    std::string m_path;
+    std::ofstream m_file;
+    std::vector<Entry> m_heap{};
+    std::size_t m_capacity;
+    std::size_t m_stored{ 0 };      // Entries in the file
+    std::size_t m_spills{ 0 };
+    cost_t m_threshold{ infinite_cost };
+};
+
+// A* with the puzzle's costs over a grid file. Only g-costs are kept, in the state cache; the
+// path is recovered afterwards by walking down from the goal to any predecessor whose g plus
+// the move cost gives the current g, so no parent links are stored. The open list gets a
+// quarter of the memory budget and spills past it, the state cache the rest.
+class external_solver_t
+{
+public:
+    external_solver_t(const external_grid_t& grid, const std::string& scratch_path, std::size_t cache_bytes)
+        : m_grid(grid)
+        , m_cache(scratch_path, grid.blocks(), cache_bytes - cache_bytes / 4)
+        , m_open(scratch_path + ".open", cache_bytes / 4)
+    {
+    }
+
+    // Returns the path cost or -1 when E is unreachable
+    cost_t solve()
+    {
+        const ivec2 start = m_grid.start();
+        const ivec2 goal = m_grid.end();
+        if (start.x < 0 || goal.x < 0)
+            throw std::runtime_error("Maze must have a start (S) and an end (E).");
+
+        util::stopwatch_t sw{};
+        m_cost = -1;
+        m_expanded = 0;
+        m_peak_open = 0;
+        m_path.clear();
+
+        spill_open_list_t<entry_t>& open = m_open;
+        open.clear();
+        g_of(start.x, start.y, true)[(int)dir_e::e] = 0;
+        open.push(entry_t{ maze_t::heuristic(start, (int)dir_e::e, goal), 0, start.x, start.y, (int)dir_e::e });
+
+        while (!open.empty())
+        {
+            m_peak_open = std::max(m_peak_open, open.size());
+            const entry_t top = open.top();
+            open.pop();
+
+            if (top.g > g_of(top.x, top.y, false)[top.facing])
+                continue;
+
+            if (top.x == goal.x && top.y == goal.y)
+            {
+                m_cost = top.g;
+                trace(top);
+                break;
+            }
+
+            ++m_expanded;
+            for (int d = 0; d < 4; ++d)
+            {
+                const ivec2 n = ivec2{ top.x, top.y } + state_t::moves[d];
+                if (!m_grid.is_open(n.x, n.y))
+                    continue;
+
+                const cost_t g = top.g + move_cost(top.facing, d);
+                cost_t& next = g_of(n.x, n.y, true)[d];
+                if (g < next)
+                {
+                    next = g;
+                    open.push(entry_t{ g + maze_t::heuristic(n, d, goal), g, n.x, n.y, d });
+                }
+            }
+        }
+
+        m_solve_time = sw.elapsed_ms();
+        return m_cost;
+    }
+
+    // Streams the text maze back out with the path drawn in, one row at a time
+    void print(const char* text_path, const char* filepath) const
+    {
+        std::ostringstream oss;
+        oss << "Dimensions: " << m_grid.size().x << " x " << m_grid.size().y << std::endl;
+        oss << "Best path cost " << m_cost << " points" << std::endl;
+        oss << "Solved in: " << m_solve_time << " ms. Search count: " << m_expanded
+            << ". Block reads: " << m_cache.reads() << ", writes: " << m_cache.writes() << ", open list spills: " << m_open.spills();
+#if DEBUG_BUILD
+        oss << " (debug build)" << std::endl;
+#else
+        oss << " (release build)" << std::endl;
+#endif
+        std::cout << oss.str();
+
+        std::ifstream in(text_path, std::ios::binary);
+        std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+        if (!in.is_open() || !out.is_open())
+            throw std::runtime_error("Failed to open file for writing.");
+        out << oss.str();
+
+        // The path was traced from E back to S, sort it so it can be drawn in row order
+        std::vector<step_t> steps(m_path);
+        std::sort(steps.begin(), steps.end(), [](const step_t& a, const step_t& b)
+        {
+            return a.pos.y != b.pos.y ? a.pos.y < b.pos.y : a.pos.x < b.pos.x;
+        });
+
+        static constexpr char arrows[] = { '^', 'v', '>', '<' };
+        std::string line;
+        std::size_t next = 0;
+        int y = 0;
+        while (std::getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty())
+                continue;
+
+            for (; next < steps.size() && steps[next].pos.y == y; ++next)
+            {
+                char& c = line[steps[next].pos.x];
+                if (c != 'S' && c != 'E')
+                    c = arrows[steps[next].facing];
+            }
+            out << line << '\n';
+            ++y;
+        }
+
+        if (!out)
+            throw std::runtime_error("Failed to write to file.");
+    }
+
+    inline cost_t cost() const { return m_cost; }
+    inline std::size_t expanded() const { return m_expanded; }
+    inline std::size_t peak_open() const { return m_peak_open; }
+    inline const state_cache_t& cache() const { return m_cache; }
+
+private:
+    struct entry_t
+    {
+        cost_t f;
+        cost_t g;
+        int x, y;
+        int facing;
+
+        // Same order as state_t: lowest f first, ties to the lower h
+        inline bool operator>(const entry_t& o) const
+        {
+            if (f == o.f)
+                return f - g > o.f - o.g;
+            return f > o.f;
+        }
+    };
+
+    struct step_t
+    {
+        ivec2 pos;
+        int facing;
+    };
+
+    inline cost_t* g_of(int x, int y, bool dirty)
+    {
+        return m_cache.tile(m_grid.block_of(x, y), m_grid.local(x, y), dirty);
+    }
+
+    // Descends the g field from the goal. A predecessor whose g plus the move equals the
+    // current g lies on an optimal path, since stored g-costs never undercut the true ones.
+    void trace(const entry_t& goal)
+    {
+        const ivec2 start = m_grid.start();
+        ivec2 pos{ goal.x, goal.y };
+        int facing = goal.facing;
+        cost_t g = goal.g;
+
+        while (true)
+        {
+            m_path.push_back(step_t{ pos, facing });
+            if (g == 0 && pos.x == start.x && pos.y == start.y)
+                break;
+
+            const ivec2 prev = pos - state_t::moves[facing];
+            const cost_t* costs = g_of(prev.x, prev.y, false);
+            int from = -1;
+            for (int f = 0; f < facings && from < 0; ++f)
+            {
+                if (costs[f] < infinite_cost && costs[f] + move_cost(f, facing) == g)
+                    from = f;
+            }
+
+            if (from < 0)
+                throw std::logic_error("Broken cost field while tracing the path.");
+
+            g = costs[from];
+            pos = prev;
+            facing = from;
+        }
+    }
+
+    const external_grid_t& m_grid;
+    state_cache_t m_cache;
+    spill_open_list_t<entry_t> m_open;
+    std::vector<step_t> m_path{};
+    cost_t m_cost{ -1 };
+    std::size_t m_expanded{ 0 };
+    std::size_t m_peak_open{ 0 };
+    int m_solve_time{ 0 };
+};
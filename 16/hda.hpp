@@ -0,0 +1,292 @@
+#pragma once
+
+#include <maze.hpp>
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <climits>
+
+// Hash-distributed A*. Every (tile, facing) state is owned by the thread its hash picks, and
+// only the owner reads or writes its record. A thread expands its own open list and ships each
+// successor to the owner's lock-free inbox in batches. The best goal cost found so far prunes
+// every open list, as in sequential A*.
+//
+// Termination: m_work counts batches in flight plus threads that still have open states below
+// the incumbent. A thread counts itself active before it retires the batches that woke it, and
+// flushes its outgoing batches before going idle, so m_work reaches zero only once no thread
+// can produce another message.
+//
+// The workers are threads of their own rather than pool tasks, since each one spins until all
+// the others are done and a task queued behind a busy pool worker would never start. Their
+// number is capped at the shared pool's concurrency(), so a solve never runs more threads
+// than there are cores while the pool sits idle.
+class hda_solver_t
+{
+public:
+    explicit hda_solver_t(maze_t& maze, int threads = 0)
+        : m_maze(maze)
+        , m_threads(std::min(threads > 0 ? threads : INT_MAX, (int)util::thread_pool_t::shared().concurrency()))
+    {
+    }
+
+    // Returns the path cost or -1 when E is unreachable
+    cost_t solve()
+    {
+        if (m_maze.start_idx == maze_t::npos || m_maze.end_idx == maze_t::npos)
+            throw std::runtime_error("Maze must have a start (S) and an end (E).");
+
+        util::stopwatch_t sw{};
+        if (!m_maze.connected(m_maze.start_idx, m_maze.end_idx))
+        {
+            m_expanded.clear();
+            m_cost = -1;
+            m_solve_time = sw.elapsed_ms();
+            return m_cost;
+        }
+
+        m_states.assign(m_maze.capacity() * facings, state_t{});
+        m_inboxes = std::vector<inbox_t>(m_threads);
+        m_expanded = std::vector<std::size_t>(m_threads, 0);
+        m_best.store(infinite_cost, std::memory_order_relaxed);
+        m_goal = 0;
+
+        // Seed the start state as a message to its owner
+        const std::size_t start = state_id(m_maze.start_idx, (int)dir_e::e);
+        m_work.store(1, std::memory_order_relaxed);
+        m_inboxes[owner(start)].push(new batch_t{ nullptr, { message_t{ start, start, 0 } } });
+
+        std::vector<std::thread> workers;
+        for (int t = 1; t < m_threads; ++t)
+            workers.emplace_back([this, t] { run(t); });
+        run(0);
+        for (auto& w : workers)
+            w.join();
+
+        const cost_t best = m_best.load(std::memory_order_relaxed);
+        m_cost = best >= infinite_cost ? -1 : best;
+        m_solve_time = sw.elapsed_ms();
+        return m_cost;
+    }
+
+    // Copies the result into the maze so print() can render it
+    void mark_path() const
+    {
+        for (std::size_t i = 0; i < m_maze.capacity(); ++i)
+            m_maze.map[i].dir = dir_e::none;
+
+        m_maze.path_cost = m_cost;
+        m_maze.path_bound = 1.0f;
+        m_maze.search_count = static_cast<int>(expanded());
+        m_maze.solve_time = m_solve_time;
+        if (m_cost >= 0)
+            m_maze.mark_path(m_states.data(), m_goal);
+    }
+
+    std::size_t expanded() const
+    {
+        std::size_t total = 0;
+        for (std::size_t e : m_expanded)
+            total += e;
+        return total;
+    }
+
+private:
+    // Outgoing messages are buffered per owner and shipped once this many pile up,
+    // or after every burst of expansions
+    static constexpr std::size_t batch_size = 64;
+
+    struct message_t
+    {
+        std::size_t state;
+        std::size_t parent;
+        cost_t g;
+    };
+
+    struct batch_t
+    {
+        batch_t* next;
+        std::vector<message_t> messages;
+    };
+
+    // Multi-producer single-consumer stack of batches; the owner takes everything at once
+    struct inbox_t
+    {
+        std::atomic<batch_t*> head{ nullptr };
+
+        void push(batch_t* batch)
+        {
+            batch->next = head.load(std::memory_order_relaxed);
+            while (!head.compare_exchange_weak(batch->next, batch, std::memory_order_release, std::memory_order_relaxed)) {}
+        }
+
+        batch_t* take()
+        {
+            if (head.load(std::memory_order_relaxed) == nullptr)
+                return nullptr;
+            return head.exchange(nullptr, std::memory_order_acquire);
+        }
+    };
+
+    struct entry_t
+    {
+        cost_t f;
+        cost_t g;
+        std::size_t state;
+        inline bool operator>(const entry_t& o) const { return f > o.f || (f == o.f && g < o.g); }
+    };
+
+    inline int owner(std::size_t state) const
+    {
+        std::uint64_t h = static_cast<std::uint64_t>(state) * 0x9E3779B97F4A7C15ull;
+        return static_cast<int>((h >> 32) % static_cast<std::uint64_t>(m_threads));
+    }
+
+    void run(int thread)
+    {
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> open;
+        std::vector<std::vector<message_t>> outgoing(m_threads);
+        const ivec2 goal = m_maze.map[m_maze.end_idx].pos;
+        bool active = false;
+        std::size_t expanded = 0;
+
+        auto flush = [&](int to)
+        {
+            if (outgoing[to].empty())
+                return;
+            m_work.fetch_add(1, std::memory_order_relaxed);
+            m_inboxes[to].push(new batch_t{ nullptr, std::move(outgoing[to]) });
+            outgoing[to].clear();
+        };
+
+        // Records a better g for a state this thread owns
+        auto receive = [&](const message_t& m)
+        {
+            state_t& s = m_states[m.state];
+            if (s.dir != dir_e::none && m.g >= s.g_cost)
+                return;
+
+            const std::size_t tile = state_tile(m.state);
+            const int facing = state_facing(m.state);
+            if (s.dir == dir_e::none)
+                s.h_cost = maze_t::heuristic(m_maze.map[tile].pos, facing, goal);
+            s.dir = static_cast<dir_e>(facing);
+            s.g_cost = m.g;
+            s.p_idx = m.parent;
+
+            if (tile == m_maze.end_idx)
+            {
+                // Rare enough to lock, and keeps the incumbent and its state in step
+                std::lock_guard<std::mutex> lock(m_goal_mutex);
+                if (m.g < m_best.load(std::memory_order_relaxed))
+                {
+                    m_best.store(m.g, std::memory_order_relaxed);
+                    m_goal = m.state;
+                }
+                return;
+            }
+
+            open.push(entry_t{ s.g_cost + s.h_cost, s.g_cost, m.state });
+        };
+
+        auto has_work = [&]
+        {
+            // Drop stale and pruned entries so the top is worth expanding
+            while (!open.empty())
+            {
+                const entry_t& top = open.top();
+                if (top.g == m_states[top.state].g_cost && top.f < m_best.load(std::memory_order_relaxed))
+                    return true;
+                open.pop();
+            }
+            return false;
+        };
+
+        while (true)
+        {
+            // Drain the inbox, becoming active before the batches stop counting as work
+            std::size_t batches = 0;
+            for (batch_t* b = m_inboxes[thread].take(); b != nullptr; ++batches)
+            {
+                for (const message_t& m : b->messages)
+                    receive(m);
+                batch_t* next = b->next;
+                delete b;
+                b = next;
+            }
+
+            const bool work = has_work();
+            if (work && !active)
+            {
+                m_work.fetch_add(1, std::memory_order_relaxed);
+                active = true;
+            }
+            if (batches > 0)
+                m_work.fetch_sub(batches, std::memory_order_acq_rel);
+
+            if (!work)
+            {
+                for (int t = 0; t < m_threads; ++t)
+                    flush(t);
+
+                if (active)
+                {
+                    m_work.fetch_sub(1, std::memory_order_acq_rel);
+                    active = false;
+                }
+
+                if (m_work.load(std::memory_order_acquire) == 0)
+                    break;
+
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Expand a handful of states between inbox checks
+            for (int i = 0; i < 16 && has_work(); ++i)
+            {
+                const entry_t top = open.top();
+                open.pop();
+                ++expanded;
+
+                const std::size_t tile = state_tile(top.state);
+                const int facing = state_facing(top.state);
+                for (unsigned exits = m_maze.map[tile].exits; exits != 0; exits &= exits - 1)
+                {
+                    const int d = util::count_trailing_zeros(exits);
+                    const std::size_t next = state_id(m_maze.step(tile, d), d);
+                    const message_t m{ next, top.state, top.g + move_cost(facing, d) };
+                    const int to = owner(next);
+                    if (to == thread)
+                    {
+                        receive(m);
+                    }
+                    else
+                    {
+                        outgoing[to].push_back(m);
+                        if (outgoing[to].size() >= batch_size)
+                            flush(to);
+                    }
+                }
+            }
+
+            // Owners starve if successors linger here, so ship partial batches too
+            for (int t = 0; t < m_threads; ++t)
+                flush(t);
+        }
+
+        m_expanded[thread] = expanded;
+    }
+
+    maze_t& m_maze;
+    int m_threads{ 1 };
+    std::vector<state_t> m_states{};
+    std::vector<inbox_t> m_inboxes{};
+    std::vector<std::size_t> m_expanded{};
+    std::atomic<cost_t> m_best{ infinite_cost };
+    std::mutex m_goal_mutex{};
+    std::size_t m_goal{ 0 };
+    std::atomic<std::int64_t> m_work{ 0 };
+    cost_t m_cost{ -1 };
+    int m_solve_time{ 0 };
+};
@@ -0,0 +1,489 @@
+#pragma once
+
+#include <maze.hpp>
+
+#include <unordered_map>
+
+// Hierarchical A*. The grid is cut into square clusters and every state that enters a cluster
+// across its border becomes a node of an abstract graph. build() connects each entrance to the
+// entrances of the neighbouring clusters it can leave into, with the exact in-cluster cost
+// including turns, so the abstract graph is exact rather than an approximation. A query only
+// searches the start and goal clusters at tile level, runs A* on the abstract graph, then
+// refines the clusters on the chosen route back into tiles.
+class hpa_solver_t
+{
+public:
+    static constexpr int default_cluster = 32;
+
+    explicit hpa_solver_t(maze_t& maze, int cluster_size = default_cluster)
+        : m_maze(maze)
+        , m_cluster(std::max(4, cluster_size))
+    {
+    }
+
+    // Finds every entrance and its in-cluster costs. Clusters are independent, so both passes
+    // run one cluster per task on the pool.
+    void build()
+    {
+        util::stopwatch_t sw{};
+        m_clusters_x = (m_maze.size.x + m_cluster - 1) / m_cluster;
+        m_clusters_y = (m_maze.size.y + m_cluster - 1) / m_cluster;
+        const std::size_t clusters = (std::size_t)m_clusters_x * m_clusters_y;
+
+        std::vector<std::vector<std::size_t>> entrances(clusters);
+        util::parallel_for(0, clusters, 64, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t c = begin; c < end; ++c)
+                entrances[c] = find_entrances(static_cast<int>(c));
+        });
+
+        // Nodes are numbered cluster by cluster
+        m_cluster_first.assign(clusters + 1, 0);
+        for (std::size_t c = 0; c < clusters; ++c)
+            m_cluster_first[c + 1] = m_cluster_first[c] + static_cast<int>(entrances[c].size());
+
+        m_nodes.clear();
+        m_nodes.reserve(m_cluster_first[clusters]);
+        m_node_of.clear();
+        m_node_of.reserve(m_cluster_first[clusters]);
+        for (std::size_t c = 0; c < clusters; ++c)
+        {
+            for (std::size_t state : entrances[c])
+            {
+                m_node_of.emplace(state, static_cast<int>(m_nodes.size()));
+                m_nodes.push_back(state);
+            }
+        }
+
+        std::vector<std::vector<edge_t>> edges(m_nodes.size());
+        util::parallel_for(0, clusters, 16, [&](std::size_t begin, std::size_t end)
+        {
+            cluster_search_t search(m_cluster);
+            for (std::size_t c = begin; c < end; ++c)
+            {
+                for (int n = m_cluster_first[c]; n < m_cluster_first[c + 1]; ++n)
+                    edges[n] = exits(search, m_nodes[n]);
+            }
+        });
+
+        m_first.assign(m_nodes.size() + 1, 0);
+        for (std::size_t n = 0; n < m_nodes.size(); ++n)
+            m_first[n + 1] = m_first[n] + edges[n].size();
+        m_edges.clear();
+        m_edges.reserve(m_first.back());
+        for (const auto& e : edges)
+            m_edges.insert(m_edges.end(), e.begin(), e.end());
+
+        m_built = true;
+        m_build_time = sw.elapsed_ms();
+    }
+
+    // Returns the path cost or -1 when E is unreachable. Builds first if build() wasn't called.
+    cost_t solve()
+    {
+        if (m_maze.start_idx == maze_t::npos || m_maze.end_idx == maze_t::npos)
+            throw std::runtime_error("Maze must have a start (S) and an end (E).");
+
+        util::stopwatch_t sw{};
+        m_cost = -1;
+        m_expanded = 0;
+        m_path.clear();
+
+        // Not worth building the graph for
+        if (!m_maze.connected(m_maze.start_idx, m_maze.end_idx))
+        {
+            m_solve_time = sw.elapsed_ms();
+            return m_cost;
+        }
+
+        if (!m_built)
+            build();
+        sw.start();
+
+        const std::size_t start = state_id(m_maze.start_idx, (int)dir_e::e);
+        const ivec2 goal = m_maze.map[m_maze.end_idx].pos;
+        const int goal_cluster = cluster_of(goal);
+        const int start_node = static_cast<int>(m_nodes.size());
+        const int goal_node = start_node + 1;
+
+        // Tile-level searches in the two end clusters: the start to the exits of its cluster,
+        // and every entrance of the goal cluster back to E
+        cluster_search_t search(m_cluster);
+        const std::vector<edge_t> start_edges = exits(search, start);
+        m_expanded += search.expanded;
+
+        search.run<true>(*this, goal_cluster, goal_seeds(goal), [](int, int, std::size_t, cost_t) {});
+        m_expanded += search.expanded;
+        std::unordered_map<int, cost_t> to_goal;
+        for (int n = m_cluster_first[goal_cluster]; n < m_cluster_first[goal_cluster + 1]; ++n)
+        {
+            const cost_t g = search.g[local_state(goal_cluster, m_nodes[n])];
+            if (g < infinite_cost)
+                to_goal.emplace(n, g);
+        }
+
+        // E in the start's own cluster can be reached without leaving it
+        cost_t direct = infinite_cost;
+        if (cluster_of(m_maze.map[m_maze.start_idx].pos) == goal_cluster)
+        {
+            search.run<false>(*this, goal_cluster, { { local_state(goal_cluster, start), cost_t(0) } }, [](int, int, std::size_t, cost_t) {});
+            for (const auto& seed : goal_seeds(goal))
+                direct = std::min(direct, search.g[seed.first]);
+        }
+
+        // A* on the abstract graph, visited nodes only so a query doesn't touch all of them
+        struct record_t
+        {
+            cost_t g;
+            int parent;
+        };
+        std::unordered_map<int, record_t> visited;
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> open;
+
+        auto h = [&](int node)
+        {
+            if (node == goal_node)
+                return cost_t(0);
+            const std::size_t state = node == start_node ? start : m_nodes[node];
+            return maze_t::heuristic(m_maze.map[state_tile(state)].pos, state_facing(state), goal);
+        };
+
+        auto relax = [&](int from, int to, cost_t g)
+        {
+            auto it = visited.find(to);
+            if (it != visited.end() && it->second.g <= g)
+                return;
+            visited[to] = record_t{ g, from };
+            open.push(entry_t{ g + h(to), g, to });
+        };
+
+        visited[start_node] = record_t{ 0, -1 };
+        open.push(entry_t{ h(start_node), 0, start_node });
+        while (!open.empty())
+        {
+            const entry_t top = open.top();
+            open.pop();
+            if (top.g > visited[top.node].g)
+                continue;
+            if (top.node == goal_node)
+            {
+                m_cost = top.g;
+                break;
+            }
+            ++m_expanded;
+
+            if (top.node == start_node)
+            {
+                for (const edge_t& e : start_edges)
+                    relax(start_node, e.target, e.cost);
+                if (direct < infinite_cost)
+                    relax(start_node, goal_node, direct);
+                continue;
+            }
+
+            for (std::size_t e = m_first[top.node]; e < m_first[top.node + 1]; ++e)
+                relax(top.node, m_edges[e].target, top.g + m_edges[e].cost);
+
+            const auto it = to_goal.find(top.node);
+            if (it != to_goal.end())
+                relax(top.node, goal_node, top.g + it->second);
+        }
+
+        if (m_cost >= 0)
+        {
+            std::vector<int> route;
+            for (int n = goal_node; n != -1; n = visited[n].parent)
+                route.push_back(n);
+            std::reverse(route.begin(), route.end());
+            refine(search, route, start, goal);
+        }
+
+        m_solve_time = sw.elapsed_ms();
+        return m_cost;
+    }
+
+    // Copies the result into the maze so print() can render it
+    void mark_path() const
+    {
+        for (std::size_t i = 0; i < m_maze.capacity(); ++i)
+            m_maze.map[i].dir = dir_e::none;
+
+        m_maze.path_cost = m_cost;
+        m_maze.path_bound = 1.0f;
+        m_maze.search_count = static_cast<int>(m_expanded);
+        m_maze.solve_time = m_solve_time;
+        for (std::size_t state : m_path)
+            m_maze.map[state_tile(state)].dir = (dir_e)(state_facing(state) | (int)dir_e::path);
+    }
+
+    inline std::size_t nodes() const { return m_nodes.size(); }
+    inline std::size_t edges() const { return m_edges.size(); }
+    inline std::size_t expanded() const { return m_expanded; }
+    inline int build_time() const { return m_build_time; }
+    inline const std::vector<std::size_t>& path() const { return m_path; }
+
+private:
+    struct edge_t
+    {
+        int target;
+        cost_t cost;
+    };
+
+    struct entry_t
+    {
+        cost_t f;
+        cost_t g;
+        int node;
+        inline bool operator>(const entry_t& o) const { return f > o.f || (f == o.f && g < o.g); }
+    };
+
+    using seeds_t = std::vector<std::pair<int, cost_t>>;
+
+    // Dijkstra over the states of one cluster, indexed by local tile * facings + facing.
+    // Forward runs report every move that leaves the cluster; backward runs follow edges in
+    // reverse, so g becomes the cost to reach the seeds.
+    struct cluster_search_t
+    {
+        explicit cluster_search_t(int cluster)
+            : g((std::size_t)cluster * cluster * facings, infinite_cost)
+            , parent(g.size(), -1)
+        {
+        }
+
+        template <bool Reverse, typename OnExit>
+        void run(const hpa_solver_t& hpa, int cluster, const seeds_t& seeds, OnExit&& on_exit)
+        {
+            std::fill(g.begin(), g.end(), infinite_cost);
+            std::fill(parent.begin(), parent.end(), -1);
+            heap.clear();
+            expanded = 0;
+
+            auto relax = [&](int s, cost_t cost, int from)
+            {
+                if (cost >= g[s])
+                    return;
+                g[s] = cost;
+                parent[s] = from;
+                heap.emplace_back(cost, s);
+                std::push_heap(heap.begin(), heap.end(), std::greater<>());
+            };
+
+            for (const auto& seed : seeds)
+                relax(seed.first, seed.second, -1);
+
+            const ivec2 origin = hpa.cluster_origin(cluster);
+            const maze_t& maze = hpa.m_maze;
+            while (!heap.empty())
+            {
+                std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+                const auto [cost, s] = heap.back();
+                heap.pop_back();
+                if (cost > g[s])
+                    continue;
+                ++expanded;
+
+                const int tile = s / facings;
+                const int facing = s % facings;
+                const ivec2 pos = origin + ivec2{ tile % hpa.m_cluster, tile / hpa.m_cluster };
+
+                if constexpr (Reverse)
+                {
+                    const ivec2 p = pos - state_t::moves[facing];
+                    if (!hpa.inside(cluster, p) || !maze.is_open(maze.idx(p.x, p.y)))
+                        continue;
+                    const int local = hpa.local_tile(cluster, p);
+                    for (int f = 0; f < facings; ++f)
+                        relax(local * facings + f, cost + move_cost(f, facing), s);
+                }
+                else
+                {
+                    for (int d = 0; d < 4; ++d)
+                    {
+                        const ivec2 n = pos + state_t::moves[d];
+                        if (n.x < 0 || n.x >= maze.size.x || n.y < 0 || n.y >= maze.size.y)
+                            continue;
+                        if (!maze.is_open(maze.idx(n.x, n.y)))
+                            continue;
+
+                        const cost_t next = cost + move_cost(facing, d);
+                        if (hpa.inside(cluster, n))
+                            relax(hpa.local_tile(cluster, n) * facings + d, next, s);
+                        else
+                            on_exit(s, d, maze.idx(n.x, n.y), next);
+                    }
+                }
+            }
+        }
+
+        std::vector<cost_t> g;
+        std::vector<int> parent;
+        std::vector<std::pair<cost_t, int>> heap;
+        std::size_t expanded{ 0 };
+    };
+
+    inline int cluster_of(const ivec2& p) const
+    {
+        return (p.y / m_cluster) * m_clusters_x + p.x / m_cluster;
+    }
+
+    inline ivec2 cluster_origin(int cluster) const
+    {
+        return ivec2{ (cluster % m_clusters_x) * m_cluster, (cluster / m_clusters_x) * m_cluster };
+    }
+
+    inline bool inside(int cluster, const ivec2& p) const
+    {
+        const ivec2 o = cluster_origin(cluster);
+        return p.x >= o.x && p.x < std::min(o.x + m_cluster, m_maze.size.x)
+            && p.y >= o.y && p.y < std::min(o.y + m_cluster, m_maze.size.y);
+    }
+
+    inline int local_tile(int cluster, const ivec2& p) const
+    {
+        const ivec2 o = cluster_origin(cluster);
+        return (p.y - o.y) * m_cluster + (p.x - o.x);
+    }
+
+    inline int local_state(int cluster, std::size_t state) const
+    {
+        return local_tile(cluster, m_maze.map[state_tile(state)].pos) * facings + state_facing(state);
+    }
+
+    inline std::size_t global_state(int cluster, int local) const
+    {
+        const ivec2 p = cluster_origin(cluster) + ivec2{ (local / facings) % m_cluster, (local / facings) / m_cluster };
+        return state_id(m_maze.idx(p.x, p.y), local % facings);
+    }
+
+    seeds_t goal_seeds(const ivec2& goal) const
+    {
+        const int cluster = cluster_of(goal);
+        seeds_t seeds;
+        for (int f = 0; f < facings; ++f)
+            seeds.emplace_back(local_tile(cluster, goal) * facings + f, cost_t(0));
+        return seeds;
+    }
+
+    // States on the cluster border entered from an open tile next door
+    std::vector<std::size_t> find_entrances(int cluster) const
+    {
+        std::vector<std::size_t> found;
+        const ivec2 o = cluster_origin(cluster);
+        const int w = std::min(m_cluster, m_maze.size.x - o.x);
+        const int h = std::min(m_cluster, m_maze.size.y - o.y);
+
+        auto check = [&](int x, int y, int out_dir)
+        {
+            if (!m_maze.is_open(m_maze.idx(x, y)))
+                return;
+            const ivec2 n = ivec2{ x, y } + state_t::moves[out_dir];
+            if (n.x < 0 || n.x >= m_maze.size.x || n.y < 0 || n.y >= m_maze.size.y)
+                return;
+            if (!m_maze.is_open(m_maze.idx(n.x, n.y)))
+                return;
+            found.push_back(state_id(m_maze.idx(x, y), opposite(out_dir)));
+        };
+
+        for (int x = o.x; x < o.x + w; ++x)
+        {
+            check(x, o.y, (int)dir_e::n);
+            check(x, o.y + h - 1, (int)dir_e::s);
+        }
+        for (int y = o.y; y < o.y + h; ++y)
+        {
+            check(o.x, y, (int)dir_e::w);
+            check(o.x + w - 1, y, (int)dir_e::e);
+        }
+        return found;
+    }
+
+    // Cheapest cost from a state to each entrance next door its cluster can be left into
+    std::vector<edge_t> exits(cluster_search_t& search, std::size_t from) const
+    {
+        const int cluster = cluster_of(m_maze.map[state_tile(from)].pos);
+        std::vector<edge_t> found;
+        search.run<false>(*this, cluster, { { local_state(cluster, from), cost_t(0) } },
+            [&](int, int d, std::size_t tile, cost_t cost)
+            {
+                found.push_back(edge_t{ m_node_of.at(state_id(tile, d)), cost });
+            });
+
+        // Several facings can leave into the same entrance, keep the cheapest
+        std::sort(found.begin(), found.end(), [](const edge_t& a, const edge_t& b)
+        {
+            return a.target != b.target ? a.target < b.target : a.cost < b.cost;
+        });
+        found.erase(std::unique(found.begin(), found.end(), [](const edge_t& a, const edge_t& b)
+        {
+            return a.target == b.target;
+        }), found.end());
+        return found;
+    }
+
+    // Re-runs the in-cluster search for each leg of the abstract route and keeps its states
+    void refine(cluster_search_t& search, const std::vector<int>& route, std::size_t start, const ivec2& goal)
+    {
+        std::size_t from = start;
+        m_path.push_back(start);
+
+        for (std::size_t r = 1; r < route.size(); ++r)
+        {
+            const int cluster = cluster_of(m_maze.map[state_tile(from)].pos);
+            const bool last = r + 1 == route.size();
+            const std::size_t target = last ? 0 : m_nodes[route[r]];
+
+            int best = -1;
+            cost_t best_cost = infinite_cost;
+            search.run<false>(*this, cluster, { { local_state(cluster, from), cost_t(0) } },
+                [&](int s, int d, std::size_t tile, cost_t cost)
+                {
+                    if (!last && state_id(tile, d) == target && cost < best_cost)
+                    {
+                        best = s;
+                        best_cost = cost;
+                    }
+                });
+            m_expanded += search.expanded;
+
+            if (last)
+            {
+                for (const auto& seed : goal_seeds(goal))
+                {
+                    if (search.g[seed.first] < best_cost)
+                    {
+                        best = seed.first;
+                        best_cost = search.g[seed.first];
+                    }
+                }
+            }
+
+            // Parent links lead back to the leg's first state, which is already on the path
+            std::vector<std::size_t> leg;
+            for (int s = best; search.parent[s] != -1; s = search.parent[s])
+                leg.push_back(global_state(cluster, s));
+            m_path.insert(m_path.end(), leg.rbegin(), leg.rend());
+
+            if (!last)
+            {
+                m_path.push_back(target);
+                from = target;
+            }
+        }
+    }
+
+    maze_t& m_maze;
+    int m_cluster{ default_cluster };
+    int m_clusters_x{ 0 };
+    int m_clusters_y{ 0 };
+    bool m_built{ false };
+    std::vector<std::size_t> m_nodes{};         // Entrance state of each node
+    std::vector<int> m_cluster_first{};         // First node of each cluster, plus the total
+    std::unordered_map<std::size_t, int> m_node_of{};
+    std::vector<std::size_t> m_first{};         // First edge of each node, plus the total
+    std::vector<edge_t> m_edges{};
+    std::vector<std::size_t> m_path{};
+    cost_t m_cost{ -1 };
+    std::size_t m_expanded{ 0 };
+    int m_build_time{ 0 };
+    int m_solve_time{ 0 };
+};
@@ -0,0 +1,452 @@
+#pragma once
+
+#include <maze.hpp>
+#include <compact.hpp>
+
+#include <queue>
+#include <set>
+
+// k shortest loopless routes from S to E, Yen's algorithm on the junction graph. Every open tile
+// that isn't a plain corridor tile (two exits), plus S and E, is a junction; a corridor is the
+// run of tiles between two junctions, walked once at build time with its steps and turns summed.
+// The graph is small next to the grid, and every search on it runs over (junction, facing)
+// states, since the cost of leaving a junction depends on how it was entered.
+//
+// build() also runs one backward Dijkstra from E over the whole graph. Those distances are an
+// exact heuristic for every spur search Yen makes: a spur search only differs from the tree by
+// the junctions and corridors it may not use, so it mostly walks straight down the tree. The
+// spur searches of an iteration are independent and run on the pool, each thread with its own
+// search records, which are invalidated by an epoch instead of cleared.
+//
+// Routes never visit a junction twice. Spur paths that would (turning around via a loop is
+// never cheaper than turning on the spot, so this is rare) are dropped.
+
+struct route_t
+{
+    cost_t cost{ -1 };
+    std::vector<std::uint32_t> corridors{};     // junction * 4 + exit direction, from S to E
+    std::vector<std::size_t> states{};          // (tile, facing) states from S to E, see state_id()
+};
+
+class kpaths_solver_t
+{
+public:
+    explicit kpaths_solver_t(const maze_t& maze)
+        : m_maze(maze)
+    {
+    }
+
+    // Finds the junctions and corridors, then the distance from every state to E. Corridor
+    // walks are independent, so they run one band of junctions per task on the pool.
+    void build()
+    {
+        util::stopwatch_t sw{};
+        if (m_maze.start_idx == maze_t::npos || m_maze.end_idx == maze_t::npos)
+            throw std::runtime_error("Maze must have a start (S) and an end (E).");
+
+        m_junction_of.assign(m_maze.capacity(), -1);
+        m_tiles.clear();
+        for (int y = 0; y < m_maze.size.y; ++y)
+        {
+            for (int x = 0; x < m_maze.size.x; ++x)
+            {
+                const std::size_t i = m_maze.idx(x, y);
+                if (!m_maze.is_open(i) || !junction(i))
+                    continue;
+                m_junction_of[i] = static_cast<int>(m_tiles.size());
+                m_tiles.push_back(i);
+            }
+        }
+
+        m_start = m_junction_of[m_maze.start_idx];
+        m_goal = m_junction_of[m_maze.end_idx];
+
+        m_corridors.assign(m_tiles.size() * 4, corridor_t{});
+        util::parallel_for(0, m_tiles.size(), 1024, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t j = begin; j < end; ++j)
+            {
+                for (unsigned exits = m_maze.map[m_tiles[j]].exits; exits != 0; exits &= exits - 1)
+                {
+                    const int d = util::count_trailing_zeros(exits);
+                    m_corridors[j * 4 + d] = walk(m_tiles[j], d);
+                }
+            }
+        });
+
+        distances_to_goal();
+        m_scratch.assign(util::thread_pool_t::shared().concurrency(), search_t{});
+        m_built = true;
+        m_build_time = sw.elapsed_ms();
+    }
+
+    // Up to k routes, cheapest first. Builds first if build() wasn't called.
+    std::vector<route_t> solve(int k)
+    {
+        util::stopwatch_t sw{};
+        std::vector<route_t> routes;
+        m_spurs = 0;
+
+        // Not worth building the graph for
+        if (!m_maze.connected(m_maze.start_idx, m_maze.end_idx))
+        {
+            m_solve_time = sw.elapsed_ms();
+            return routes;
+        }
+
+        if (!m_built)
+            build();
+        sw.start();
+
+        const std::uint32_t start_state = static_cast<std::uint32_t>(m_start * 4 + (int)dir_e::e);
+        if (k <= 0 || m_to_goal[start_state] >= infinite_cost)
+        {
+            m_solve_time = sw.elapsed_ms();
+            return routes;
+        }
+
+        route_t first{};
+        spur_t none{};
+        if (!search(m_scratch[0], start_state, none, first))
+        {
+            m_solve_time = sw.elapsed_ms();
+            return routes;
+        }
+        routes.push_back(first);
+
+        std::vector<route_t> candidates;
+        std::set<std::vector<std::uint32_t>> seen{ first.corridors };
+        util::thread_pool_t& pool = util::thread_pool_t::shared();
+
+        while ((int)routes.size() < k)
+        {
+            // Junction states and the cost so far at every node of the last route
+            const route_t& last = routes.back();
+            const std::size_t nodes = last.corridors.size();
+            std::vector<std::uint32_t> node_states(nodes + 1);
+            std::vector<cost_t> root_costs(nodes + 1, 0);
+            node_states[0] = start_state;
+            for (std::size_t i = 0; i < nodes; ++i)
+            {
+                const std::uint32_t c = last.corridors[i];
+                const corridor_t& corridor = m_corridors[c];
+                root_costs[i + 1] = root_costs[i] + move_cost((int)(node_states[i] % 4), (int)(c % 4)) + corridor.cost;
+                node_states[i + 1] = static_cast<std::uint32_t>(corridor.to * 4 + corridor.arrive);
+            }
+
+            // One spur search per node of the last route, all on the pool
+            std::vector<route_t> spurs(nodes);
+            util::parallel_for(pool, 0, nodes, 4, [&](std::size_t begin, std::size_t end)
+            {
+                search_t& scratch = m_scratch[pool.slot() % m_scratch.size()];
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    spur_t spur{};
+                    for (std::size_t n = 0; n <= i; ++n)
+                        spur.junctions.push_back(static_cast<int>(node_states[n] / 4));
+
+                    // Corridors that would rebuild a route already found with the same root
+                    for (const route_t& r : routes)
+                    {
+                        if (r.corridors.size() > i && std::equal(last.corridors.begin(), last.corridors.begin() + i, r.corridors.begin()))
+                            spur.corridors.push_back(r.corridors[i]);
+                    }
+
+                    route_t tail{};
+                    if (!search(scratch, node_states[i], spur, tail))
+                        continue;
+
+                    route_t& route = spurs[i];
+                    route.cost = root_costs[i] + tail.cost;
+                    route.corridors.assign(last.corridors.begin(), last.corridors.begin() + i);
+                    route.corridors.insert(route.corridors.end(), tail.corridors.begin(), tail.corridors.end());
+                }
+            });
+            m_spurs += nodes;
+
+            for (route_t& route : spurs)
+            {
+                if (route.cost >= 0 && seen.insert(route.corridors).second)
+                    candidates.push_back(std::move(route));
+            }
+
+            if (candidates.empty())
+                break;
+
+            // Cheapest candidate, fewer corridors first on a tie
+            const auto best = std::min_element(candidates.begin(), candidates.end(), [](const route_t& a, const route_t& b)
+            {
+                return a.cost < b.cost || (a.cost == b.cost && a.corridors.size() < b.corridors.size());
+            });
+            routes.push_back(std::move(*best));
+            candidates.erase(best);
+        }
+
+        for (route_t& route : routes)
+            route.states = expand(route.corridors);
+
+        m_solve_time = sw.elapsed_ms();
+        return routes;
+    }
+
+    inline std::size_t junctions() const { return m_tiles.size(); }
+    inline std::size_t spurs() const { return m_spurs; }
+    inline int build_time() const { return m_build_time; }
+    inline int solve_time() const { return m_solve_time; }
+
+private:
+    struct corridor_t
+    {
+        int to{ -1 };           // Junction at the far end, -1 for no exit this way
+        int arrive{ 0 };        // Facing on arrival there
+        cost_t cost{ 0 };       // Every move after the first, which the caller charges with its turn
+    };
+
+    // Junctions and corridors a spur search may not use
+    struct spur_t
+    {
+        std::vector<int> junctions{};
+        std::vector<std::uint32_t> corridors{};
+    };
+
+    // One thread's search records, valid where the epoch matches
+    struct search_t
+    {
+        std::vector<std::uint32_t> epoch{};
+        std::vector<cost_t> g{};
+        std::vector<std::uint32_t> parent{};    // Corridor that reached the state
+        std::vector<std::uint32_t> from{};      // State that corridor left from
+        std::vector<std::uint32_t> banned{};    // Junctions banned in the current epoch
+        std::uint32_t current{ 0 };
+    };
+
+    // Anything but an empty tile with exactly two exits, straight or a corner
+    inline bool junction(std::size_t i) const
+    {
+        const unsigned exits = m_maze.map[i].exits;
+        const unsigned rest = exits & (exits - 1);
+        const bool two_exits = rest != 0 && (rest & (rest - 1)) == 0;
+        return m_maze.map[i].type != tile_e::empty || !two_exits;
+    }
+
+    // Follows the corridor leaving tile in direction d up to the next junction
+    corridor_t walk(std::size_t tile, int d) const
+    {
+        corridor_t c{};
+        int facing = d;
+        std::size_t t = m_maze.step(tile, d);
+        while (m_junction_of[t] < 0)
+        {
+            const int next = util::count_trailing_zeros(m_maze.map[t].exits & ~(1u << opposite(facing)));
+            c.cost += move_cost(facing, next);
+            t = m_maze.step(t, next);
+            facing = next;
+        }
+        c.to = m_junction_of[t];
+        c.arrive = facing;
+        return c;
+    }
+
+    // Backward Dijkstra from every facing on E over the corridors, read as incoming edges
+    void distances_to_goal()
+    {
+        const std::size_t states = m_tiles.size() * 4;
+        std::vector<std::uint32_t> first(states + 1, 0), incoming;
+        for (std::size_t c = 0; c < m_corridors.size(); ++c)
+        {
+            if (m_corridors[c].to >= 0)
+                ++first[m_corridors[c].to * 4 + m_corridors[c].arrive + 1];
+        }
+        for (std::size_t s = 0; s < states; ++s)
+            first[s + 1] += first[s];
+        incoming.resize(first.back());
+        std::vector<std::uint32_t> fill(first.begin(), first.end() - 1);
+        for (std::size_t c = 0; c < m_corridors.size(); ++c)
+        {
+            if (m_corridors[c].to >= 0)
+                incoming[fill[m_corridors[c].to * 4 + m_corridors[c].arrive]++] = static_cast<std::uint32_t>(c);
+        }
+
+        using entry_t = std::pair<cost_t, std::uint32_t>;
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> open;
+        m_to_goal.assign(states, infinite_cost);
+        for (int f = 0; f < facings; ++f)
+        {
+            m_to_goal[m_goal * 4 + f] = 0;
+            open.push({ 0, static_cast<std::uint32_t>(m_goal * 4 + f) });
+        }
+
+        while (!open.empty())
+        {
+            const entry_t top = open.top();
+            open.pop();
+            if (top.first > m_to_goal[top.second])
+                continue;
+
+            for (std::uint32_t k = first[top.second]; k < first[top.second + 1]; ++k)
+            {
+                const std::uint32_t c = incoming[k];
+                const std::size_t j = c / 4;
+                const int d = static_cast<int>(c % 4);
+                if ((int)j == m_goal)
+                    continue;
+                for (int f = 0; f < facings; ++f)
+                {
+                    const std::size_t s = j * 4 + f;
+                    const cost_t nd = top.first + move_cost(f, d) + m_corridors[c].cost;
+                    if (nd < m_to_goal[s])
+                    {
+                        m_to_goal[s] = nd;
+                        open.push({ nd, static_cast<std::uint32_t>(s) });
+                    }
+                }
+            }
+        }
+    }
+
+    // A* from a junction state to E with the backward distances as heuristic. Fills the
+    // corridors and cost of the path found, false when the bans leave no way to E.
+    bool search(search_t& scratch, std::uint32_t from, const spur_t& spur, route_t& out) const
+    {
+        const std::size_t states = m_tiles.size() * 4;
+        if (scratch.epoch.size() != states)
+        {
+            scratch.epoch.assign(states, 0);
+            scratch.g.assign(states, 0);
+            scratch.parent.assign(states, 0);
+            scratch.from.assign(states, 0);
+            scratch.banned.assign(m_tiles.size(), 0);
+            scratch.current = 0;
+        }
+        const std::uint32_t epoch = ++scratch.current;
+        for (int j : spur.junctions)
+            scratch.banned[j] = epoch;
+
+        struct entry_t
+        {
+            cost_t f;
+            cost_t g;
+            std::uint32_t state;
+            inline bool operator>(const entry_t& o) const { return f > o.f || (f == o.f && g < o.g); }
+        };
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> open;
+
+        scratch.epoch[from] = epoch;
+        scratch.g[from] = 0;
+        open.push({ m_to_goal[from], 0, from });
+
+        while (!open.empty())
+        {
+            const entry_t top = open.top();
+            open.pop();
+            if (top.g > scratch.g[top.state])
+                continue;
+
+            const std::size_t j = top.state / 4;
+            if ((int)j == m_goal)
+            {
+                out.cost = top.g;
+                out.corridors.clear();
+                for (std::uint32_t s = top.state; s != from; s = scratch.from[s])
+                    out.corridors.push_back(scratch.parent[s]);
+                std::reverse(out.corridors.begin(), out.corridors.end());
+                return loopless(from, out.corridors);
+            }
+
+            const int facing = static_cast<int>(top.state % 4);
+            for (unsigned exits = m_maze.map[m_tiles[j]].exits; exits != 0; exits &= exits - 1)
+            {
+                const int d = util::count_trailing_zeros(exits);
+                const std::uint32_t c = static_cast<std::uint32_t>(j * 4 + d);
+                const corridor_t& corridor = m_corridors[c];
+                if (scratch.banned[corridor.to] == epoch)
+                    continue;
+                if (std::find(spur.corridors.begin(), spur.corridors.end(), c) != spur.corridors.end())
+                    continue;
+
+                const std::uint32_t next = static_cast<std::uint32_t>(corridor.to * 4 + corridor.arrive);
+                if (m_to_goal[next] >= infinite_cost)
+                    continue;
+
+                const cost_t g = top.g + move_cost(facing, d) + corridor.cost;
+                if (scratch.epoch[next] == epoch && g >= scratch.g[next])
+                    continue;
+
+                scratch.epoch[next] = epoch;
+                scratch.g[next] = g;
+                scratch.parent[next] = c;
+                scratch.from[next] = top.state;
+                open.push({ g + m_to_goal[next], g, next });
+            }
+        }
+        return false;
+    }
+
+    // True when no junction repeats along the corridors from the given state
+    bool loopless(std::uint32_t from, const std::vector<std::uint32_t>& corridors) const
+    {
+        std::vector<int> visited{ static_cast<int>(from / 4) };
+        for (std::uint32_t c : corridors)
+            visited.push_back(m_corridors[c].to);
+        std::sort(visited.begin(), visited.end());
+        return std::adjacent_find(visited.begin(), visited.end()) == visited.end();
+    }
+
+    // Walks the corridors again to list every (tile, facing) state from S facing east
+    std::vector<std::size_t> expand(const std::vector<std::uint32_t>& corridors) const
+    {
+        std::vector<std::size_t> states{ state_id(m_maze.start_idx, (int)dir_e::e) };
+        for (std::uint32_t c : corridors)
+        {
+            int facing = static_cast<int>(c % 4);
+            std::size_t t = m_maze.step(m_tiles[c / 4], facing);
+            states.push_back(state_id(t, facing));
+            while (m_junction_of[t] < 0)
+            {
+                facing = util::count_trailing_zeros(m_maze.map[t].exits & ~(1u << opposite(facing)));
+                t = m_maze.step(t, facing);
+                states.push_back(state_id(t, facing));
+            }
+        }
+        return states;
+    }
+
+    const maze_t& m_maze;
+    std::vector<int> m_junction_of{};
+    std::vector<std::size_t> m_tiles{};
+    std::vector<corridor_t> m_corridors{};
+    std::vector<cost_t> m_to_goal{};
+    std::vector<search_t> m_scratch{};
+    int m_start{ -1 };
+    int m_goal{ -1 };
+    std::size_t m_spurs{ 0 };
+    bool m_built{ false };
+    int m_build_time{ 0 };
+    int m_solve_time{ 0 };
+};
+
+// Writes print()'s summary for the best route, then every route with its cost and its moves
+// in the --format=path notation
+static void write_routes(maze_t& maze, const std::vector<route_t>& routes, int solve_time, const char* filepath)
+{
+    solve_result_t best{};
+    best.solve_time = solve_time;
+    if (!routes.empty())
+    {
+        best.cost = routes.front().cost;
+        best.path = routes.front().states;
+    }
+    maze.apply(best);
+
+    const std::string summary = maze.header();
+    std::ostringstream oss;
+    oss << summary;
+    for (std::size_t r = 0; r < routes.size(); ++r)
+    {
+        std::cout << "Route " << r + 1 << ": cost " << routes[r].cost << ", " << routes[r].states.size() << " tiles" << std::endl;
+        oss << "Route " << r + 1 << " cost " << routes[r].cost << ", " << routes[r].states.size() << " tiles: "
+            << encode_moves(routes[r].states) << std::endl;
+    }
+    std::cout << summary;
+    util::write_file(filepath, oss.str());
+}
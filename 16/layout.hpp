@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Memory layouts for 2D grids. Every layout maps (x, y) to a flat index, so code that
+// only goes through idx() works unchanged whichever one is picked.
+enum struct layout_e : std::uint8_t { row_major, tiled, morton };
+
+struct layout_t
+{
+    static constexpr int tile_shift = 3;    // 8x8 blocks, row-major inside a block
+    static constexpr int morton_shift = 6;  // 64x64 blocks, Z-order inside a block
+
+    layout_e kind{ layout_e::row_major };
+    int width{ 0 };
+    int height{ 0 };
+    int blocks_x{ 0 };
+    int blocks_y{ 0 };
+
+    static layout_e parse(const std::string& name)
+    {
+        if (name == "row" || name == "row_major") return layout_e::row_major;
+        if (name == "tiled") return layout_e::tiled;
+        if (name == "morton") return layout_e::morton;
+        throw std::invalid_argument("Unknown layout: " + name);
+    }
+
+    static const char* name(layout_e kind)
+    {
+        switch (kind)
+        {
+        case layout_e::row_major: return "row_major";
+        case layout_e::tiled: return "tiled";
+        case layout_e::morton: return "morton";
+        default: return "?";
+        }
+    }
+
+    inline int block_shift() const
+    {
+        return kind == layout_e::tiled ? tile_shift : morton_shift;
+    }
+
+    inline void resize(int w, int h)
+    {
+        width = w;
+        height = h;
+        if (kind == layout_e::row_major)
+        {
+            blocks_x = blocks_y = 0;
+            return;
+        }
+
+        const int block = 1 << block_shift();
+        blocks_x = (w + block - 1) / block;
+        blocks_y = (h + block - 1) / block;
+    }
+
+    // Number of slots to allocate, blocked layouts pad the grid up to whole blocks
+    inline std::size_t capacity() const
+    {
+        if (kind == layout_e::row_major)
+            return (std::size_t)width * height;
+
+        return (std::size_t)blocks_x * blocks_y << (2 * block_shift());
+    }
+
+    // Spreads the low 6 bits of v so they occupy the even bit positions
+    static inline std::uint32_t spread_bits(std::uint32_t v)
+    {
+        v = (v | (v << 4)) & 0x0F0Fu;
+        v = (v | (v << 2)) & 0x3333u;
+        v = (v | (v << 1)) & 0x5555u;
+        return v;
+    }
+
+    inline std::size_t idx(int x, int y) const
+    {
+        switch (kind)
+        {
+        case layout_e::tiled:
+        {
+            const std::size_t block = (std::size_t)(y >> tile_shift) * blocks_x + (x >> tile_shift);
+            const int mask = (1 << tile_shift) - 1;
+            return (block << (2 * tile_shift)) | (std::size_t)((y & mask) << tile_shift) | (std::size_t)(x & mask);
+        }
+        case layout_e::morton:
+        {
+            const std::size_t block = (std::size_t)(y >> morton_shift) * blocks_x + (x >> morton_shift);
+            const int mask = (1 << morton_shift) - 1;
+            return (block << (2 * morton_shift)) | (spread_bits(y & mask) << 1) | spread_bits(x & mask);
+        }
+        default:
+            return (std::size_t)y * width + x;
+        }
+    }
+};
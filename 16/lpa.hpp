@@ -0,0 +1,352 @@
+#pragma once
+
+#include <maze.hpp>
+
+#include <algorithm>
+
+// A tile changed by an interactive edit
+struct tile_edit_t
+{
+    ivec2 pos{ 0, 0 };
+    tile_e type{ tile_e::empty };
+};
+
+// Lifelong Planning A* over the (tile, facing) graph. The search state survives between
+// calls, so after apply() only the part of the cost field the edits invalidated is repaired.
+// Edges from every E state to a virtual goal node let the goal accept any facing; moving E
+// re-keys the open list instead of starting over, only moving S forces a full reset.
+class incremental_solver_t
+{
+public:
+    explicit incremental_solver_t(maze_t& maze)
+        : m_maze(maze)
+    {
+        reset();
+    }
+
+    // Runs until the goal is consistent, returns the path cost or -1 when E is unreachable
+    cost_t solve()
+    {
+        util::stopwatch_t sw{};
+        m_expanded = 0;
+
+        while (true)
+        {
+            if (!clean_top())
+                break;
+
+            // Ties must still be expanded: the goal edges cost nothing, so an underconsistent
+            // E state shares its key with the goal node
+            const entry_t top = m_open.front();
+            const key_t goal_key = key(m_goal);
+            if (goal_key < top.key && m_rhs[m_goal] == m_g[m_goal])
+                break;
+
+            std::pop_heap(m_open.begin(), m_open.end(), entry_greater);
+            m_open.pop_back();
+            ++m_expanded;
+
+            const std::size_t u = top.state;
+            if (m_g[u] > m_rhs[u])
+            {
+                m_g[u] = m_rhs[u];
+                for_each_successor(u, [&](std::size_t s) { update(s); });
+            }
+            else
+            {
+                m_g[u] = infinite_cost;
+                update(u);
+                for_each_successor(u, [&](std::size_t s) { update(s); });
+            }
+        }
+
+        m_solve_time = sw.elapsed_ms();
+        return m_g[m_goal] >= infinite_cost ? -1 : m_g[m_goal];
+    }
+
+    // Writes the edits into the maze and marks every state whose edges changed
+    void apply(const std::vector<tile_edit_t>& edits)
+    {
+        // Validate first so a rejected batch leaves the maze untouched
+        std::size_t start = m_maze.start_idx;
+        std::size_t goal = m_maze.end_idx;
+        for (const auto& edit : edits)
+        {
+            if (edit.pos.x < 0 || edit.pos.x >= m_maze.size.x || edit.pos.y < 0 || edit.pos.y >= m_maze.size.y)
+                throw std::out_of_range("Edit outside the maze.");
+
+            const std::size_t t = m_maze.idx(edit.pos.x, edit.pos.y);
+            if (edit.type == tile_e::start) { start = t; }
+            else if (t == start) { start = maze_t::npos; }
+            if (edit.type == tile_e::end) { goal = t; }
+            else if (t == goal) { goal = maze_t::npos; }
+        }
+
+        if (start == maze_t::npos || goal == maze_t::npos)
+            throw std::invalid_argument("Edits must leave the maze with an S and an E.");
+
+        const bool moved_start = start != m_maze.start_idx;
+        const bool moved_goal = goal != m_maze.end_idx;
+
+        // Pruning only holds for the maze it ran on, an edit can turn a dead end into a route
+        if (m_maze.pruned > 0)
+        {
+            for (std::size_t t = 0; t < m_maze.capacity(); ++t)
+            {
+                if (m_maze.map[t].type != tile_e::dead)
+                    continue;
+                m_maze.set_type(t, tile_e::empty);
+                if (!moved_start)
+                    touch(t);
+            }
+            m_maze.pruned = 0;
+        }
+
+        for (const auto& edit : edits)
+        {
+            const std::size_t t = m_maze.idx(edit.pos.x, edit.pos.y);
+            if (m_maze.map[t].type == edit.type)
+                continue;
+
+            // Opening a wall can join components, closing one at worst leaves a stale "connected"
+            if (m_maze.map[t].type == tile_e::wall)
+                m_maze.component = nullptr;
+
+            m_maze.set_type(t, edit.type);
+            if (!moved_start)
+                touch(t);
+        }
+
+        // The old endpoints stay behind as empty tiles
+        if (moved_start && m_maze.map[m_maze.start_idx].type == tile_e::start)
+            m_maze.set_type(m_maze.start_idx, tile_e::empty);
+        if (moved_goal && m_maze.map[m_maze.end_idx].type == tile_e::end)
+            m_maze.set_type(m_maze.end_idx, tile_e::empty);
+
+        std::replace(m_maze.starts.begin(), m_maze.starts.end(), m_maze.start_idx, start);
+        std::replace(m_maze.ends.begin(), m_maze.ends.end(), m_maze.end_idx, goal);
+        m_maze.start_idx = start;
+        m_maze.end_idx = goal;
+
+        if (moved_start)
+        {
+            reset();
+        }
+        else if (moved_goal)
+        {
+            // g-values are distances from S, so only the keys depend on E
+            for (auto& e : m_open)
+                e.key = key(e.state);
+            std::make_heap(m_open.begin(), m_open.end(), entry_greater);
+            update(m_goal);
+        }
+    }
+
+    // States from S to E, empty when there is no path
+    std::vector<std::size_t> path() const
+    {
+        std::vector<std::size_t> states;
+        if (m_g[m_goal] >= infinite_cost)
+            return states;
+
+        // Walk back along the predecessors that explain each g-value
+        std::size_t u = m_goal;
+        while (u != m_start)
+        {
+            std::size_t best = u;
+            cost_t best_cost = infinite_cost;
+            for_each_predecessor(u, [&](std::size_t p, cost_t c)
+            {
+                if (m_g[p] < infinite_cost && m_g[p] + c < best_cost)
+                {
+                    best = p;
+                    best_cost = m_g[p] + c;
+                }
+            });
+
+            if (best == u)
+                break;
+            states.push_back(best);
+            u = best;
+        }
+
+        std::reverse(states.begin(), states.end());
+        return states;
+    }
+
+    // Copies the current result into the maze so print() can render it
+    void mark_path() const
+    {
+        for (std::size_t i = 0; i < m_maze.capacity(); ++i)
+            m_maze.map[i].dir = dir_e::none;
+
+        const std::vector<std::size_t> states = path();
+        for (std::size_t s : states)
+            m_maze.map[state_tile(s)].dir = (dir_e)(state_facing(s) | (int)dir_e::path);
+
+        m_maze.path_cost = m_g[m_goal] >= infinite_cost ? -1 : m_g[m_goal];
+        m_maze.path_bound = 1.0f;
+        m_maze.search_count = static_cast<int>(m_expanded);
+        m_maze.solve_time = m_solve_time;
+    }
+
+    std::size_t expanded() const { return m_expanded; }
+
+private:
+    struct key_t
+    {
+        cost_t k1{ 0 };
+        cost_t k2{ 0 };
+        inline bool operator<(const key_t& o) const { return k1 < o.k1 || (k1 == o.k1 && k2 < o.k2); }
+        inline bool operator!=(const key_t& o) const { return k1 != o.k1 || k2 != o.k2; }
+    };
+
+    struct entry_t
+    {
+        key_t key{};
+        std::size_t state{ 0 };
+    };
+
+    static bool entry_greater(const entry_t& a, const entry_t& b) { return b.key < a.key; }
+
+    void reset()
+    {
+        if (m_maze.start_idx == maze_t::npos || m_maze.end_idx == maze_t::npos)
+            throw std::runtime_error("Maze must have a start (S) and an end (E).");
+
+        m_goal = m_maze.capacity() * facings;
+        m_start = state_id(m_maze.start_idx, (int)dir_e::e);
+        m_g.assign(m_goal + 1, infinite_cost);
+        m_rhs.assign(m_goal + 1, infinite_cost);
+        m_open.clear();
+
+        m_rhs[m_start] = 0;
+        push(m_start);
+    }
+
+    key_t key(std::size_t s) const
+    {
+        const cost_t g = std::min(m_g[s], m_rhs[s]);
+        if (g >= infinite_cost)
+            return key_t{ infinite_cost, infinite_cost };
+
+        cost_t h = 0;
+        if (s != m_goal)
+            h = maze_t::heuristic(m_maze.map[state_tile(s)].pos, state_facing(s), m_maze.map[m_maze.end_idx].pos);
+        return key_t{ g + h, g };
+    }
+
+    void push(std::size_t s)
+    {
+        m_open.push_back(entry_t{ key(s), s });
+        std::push_heap(m_open.begin(), m_open.end(), entry_greater);
+    }
+
+    // Drops consistent states and stale keys from the top, false once the open list is empty
+    bool clean_top()
+    {
+        while (!m_open.empty())
+        {
+            const entry_t top = m_open.front();
+            if (m_g[top.state] != m_rhs[top.state])
+            {
+                const key_t k = key(top.state);
+                if (!(top.key != k))
+                    return true;
+            }
+
+            std::pop_heap(m_open.begin(), m_open.end(), entry_greater);
+            m_open.pop_back();
+            if (m_g[top.state] != m_rhs[top.state])
+                push(top.state);
+        }
+        return false;
+    }
+
+    void update(std::size_t u)
+    {
+        if (u != m_start)
+        {
+            cost_t rhs = infinite_cost;
+            for_each_predecessor(u, [&](std::size_t p, cost_t c)
+            {
+                if (m_g[p] < infinite_cost)
+                    rhs = std::min(rhs, m_g[p] + c);
+            });
+            m_rhs[u] = rhs;
+        }
+
+        if (m_g[u] != m_rhs[u])
+            push(u);
+    }
+
+    // Every state whose incoming edges depend on tile t
+    void touch(std::size_t t)
+    {
+        for (int f = 0; f < facings; ++f)
+            update(state_id(t, f));
+
+        for (int d = 0; d < 4; ++d)
+        {
+            const std::ptrdiff_t n = m_maze.neighbor(t, d);
+            if (n >= 0)
+                update(state_id(n, d));
+        }
+
+        if (t == m_maze.end_idx)
+            update(m_goal);
+    }
+
+    template <typename Fn>
+    void for_each_successor(std::size_t u, Fn&& fn) const
+    {
+        if (u == m_goal)
+            return;
+
+        const std::size_t t = state_tile(u);
+        if (!m_maze.is_open(t))
+            return;
+
+        for (unsigned exits = m_maze.map[t].exits; exits != 0; exits &= exits - 1)
+        {
+            const int d = util::count_trailing_zeros(exits);
+            fn(state_id(m_maze.step(t, d), d));
+        }
+
+        if (t == m_maze.end_idx)
+            fn(m_goal);
+    }
+
+    template <typename Fn>
+    void for_each_predecessor(std::size_t u, Fn&& fn) const
+    {
+        if (u == m_goal)
+        {
+            for (int f = 0; f < facings; ++f)
+                fn(state_id(m_maze.end_idx, f), 0);
+            return;
+        }
+
+        const std::size_t t = state_tile(u);
+        const int d = state_facing(u);
+        if (!m_maze.is_open(t))
+            return;
+
+        // Arriving facing d means the previous tile lies behind us
+        if ((m_maze.map[t].exits & (1u << opposite(d))) == 0)
+            return;
+
+        const std::size_t p = m_maze.step(t, opposite(d));
+        for (int f = 0; f < facings; ++f)
+            fn(state_id(p, f), move_cost(f, d));
+    }
+
+    maze_t& m_maze;
+    std::vector<cost_t> m_g{};
+    std::vector<cost_t> m_rhs{};
+    std::vector<entry_t> m_open{};
+    std::size_t m_start{ 0 };
+    std::size_t m_goal{ 0 };
+    std::size_t m_expanded{ 0 };
+    int m_solve_time{ 0 };
+};
@@ -1,329 +1,347 @@
-#include <util.hpp>
-
-#include <queue>
-#include <unordered_map>
-#include <cmath>
-
-using u8 = unsigned char;
-enum struct tile_e : u8 { invalid, empty, wall, start, end };
-enum struct dir_e : u8 { n, s, e, w, none, path = 0xF0 };
-
-struct ivec2
-{
-    int x{ 0 }, y{ 0 };
-    inline ivec2 operator+(const ivec2& o) const { return ivec2{ x + o.x, y + o.y }; }
-    inline ivec2 operator-(const ivec2& o) const { return ivec2{ x - o.x, y - o.y }; }
-};
-
-struct state_t
-{
-    static constexpr ivec2 moves[] =
-    {
-        ivec2{ 0, -1},   // North
-        ivec2{ 0,  1},   // South
-        ivec2{ 1,  0},   // East
-        ivec2{-1,  0}    // West
-    };
-
-    dir_e dir{ dir_e::none };
-    int g_cost{ 0 };
-    int h_cost{ 0 };
-    int p_idx{ 0 };
-
-    inline int f_cost() const { return g_cost + h_cost; }
-    inline bool operator>(const state_t& other) const
-    {
-        if (f_cost() == other.f_cost())
-            return h_cost > other.h_cost;
-        return f_cost() > other.f_cost();
-    }
-
-    inline void reset()
-    {
-        dir = dir_e::none;
-        g_cost = 0;
-        h_cost = 0;
-        p_idx = 0;
-    }
-};
-
-struct tile_t
-{
-    tile_e type{ tile_e::empty };
-    ivec2 pos{ 0, 0 };
-    state_t state{};
-};
-
-struct maze_t
+#include <maze.hpp>
+#include <bench.hpp>
+#include <external.hpp>
+#include <compact.hpp>
+#include <pipeline.hpp>
+#include <daemon.hpp>
+#include <kpaths.hpp>
+#include <distance_field.hpp>
+
+static std::vector<std::string> parse_list(const std::string& list)
 {
-    ivec2 size{ 0, 0 };
-    tile_t* map{ nullptr };
-    int solve_time{ 0 };
-    int search_count{ 0 };
-    int path_cost{ 0 };
-
-    inline std::size_t idx(int x, int y) const { return (std::size_t)y * size.x + x; }
-    inline tile_t& get(int x, int y) { return map[idx(x, y)]; }
-    inline const tile_t& get(int x, int y) const { return map[idx(x, y)]; }
-
-    static constexpr tile_e char_to_tile(char c);
-    static constexpr char tile_to_char(const tile_t& t);
-    
-    static int heuristic(const tile_t& a, const tile_t& b);
-
-    void load(const char* filepath);
-    void unload();
-
-    void print(const char* filepath) const;
-    void solve();
-};
+    std::vector<std::string> values;
+    std::istringstream iss(list);
+    std::string item;
+    while (std::getline(iss, item, ','))
+        values.push_back(item);
+    return values;
+}
 
-constexpr tile_e maze_t::char_to_tile(char c)
+static std::vector<int> parse_int_list(const std::string& list)
 {
-    switch (c) {
-    case '.': return tile_e::empty;
-    case '#': return tile_e::wall;
-    case 'S': return tile_e::start;
-    case 'E': return tile_e::end;
-    default: return tile_e::invalid;
-    }
+    std::vector<int> values;
+    for (const std::string& item : parse_list(list))
+        values.push_back(std::stoi(item));
+    return values;
 }
 
-constexpr char maze_t::tile_to_char(const tile_t& t)
+int main(int argc, char** args)
 {
-    const dir_e masked_dir = (dir_e)((int)t.state.dir ^ (int)dir_e::path);
-    const bool is_path = ((int)t.state.dir & (int)dir_e::path) > 0;
+    /*
+    * Example 1: 7036
+    * Example 2: 11048
+    * Input: 107468
+    *
+    * Usage: app [input] [output] [--layout=row_major|tiled|morton] [--weight=W] [--anytime=MS]
+    *            [--engine=astar|lpa|ara|delta|hda|hpa] [--threads=N] [--cost=puzzle|strict|uniform|weighted]
+    *            [--weights=FILE]   Tile weights for --cost=weighted, a digit per tile in a file shaped like the maze
+    *            [--pages=small|thp|huge] [--external[=cache MB]] [--prune]
+    *            [--queue=binary|quad|pairing|radix|bucket] [--goals=nearest|all] [--kpaths=K]
+    *            [--field[=FILE]]   Answers from a distance field to E, loaded from FILE or built and saved there
+    *            [--from=X,Y]   Starts the --field answer on this tile facing east instead of on S
+    *            [--format=grid|path]
+    *        app --bench[=layout|incremental|engines|hierarchy|queries|queues|kpaths|field|sweep] [--sizes=1001,2001] [--families=perfect,braided,open]
+    *            [--layout=...] [--seed=N] [--repeats=N] [--edits=N] [--engines=a,b] [--threads=1,2,4]
+    *            [--pages=...] [--cluster=N] [--queues=a,b] [--kpaths=K] [--out=FILE.csv|json] [--baseline=FILE.csv] [--threshold=PCT] [--floor=MS]
+    *        app --batch=LIST [--layout=...] [--format=...] [--prune]   One "input [output]" per line of LIST
+    *        app --daemon[=SOCKET] [--threads=N]   Serves solves to the `client` tool
+    *        app [input] [output] --render=PATH   Draws a path written with --format=path onto the maze
+    */
 
-    if (is_path && t.type != tile_e::start && t.type != tile_e::end)
+    try
     {
-        switch (masked_dir)
+        std::vector<std::string> positional;
+        bench_options_t bench{};
+        std::string benchmark;
+        bool layout_set = false;
+        layout_e layout = layout_e::row_major;
+        float weight = 1.0f;
+        int anytime_ms = -1;
+        std::string engine;
+        std::string cost = "puzzle";
+        std::string weights;
+        util::page_mode_e pages = util::page_mode_e::small;
+        int external_mb = -1;
+        bool prune = false;
+        std::string format = "grid";
+        std::string render;
+        std::string batch;
+        std::string daemon;
+        queue_e queue = queue_e::binary;
+        std::string goals;
+        int kpaths = 0;
+        bool field = false;
+        std::string field_path;
+        std::vector<int> from;
+
+        for (int i = 1; i < argc; ++i)
         {
-        case dir_e::n: return '^';
-        case dir_e::s: return 'v';
-        case dir_e::e: return '>';
-        case dir_e::w: return '<';
-        default: return '?';
+            const std::string arg = args[i];
+            const std::size_t eq = arg.find('=');
+            const std::string key = arg.substr(0, eq);
+            const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+            if (arg.compare(0, 2, "--") != 0) { positional.push_back(arg); }
+            else if (key == "--bench") { benchmark = value.empty() ? "layout" : value; }
+            else if (key == "--layout") { layout = layout_t::parse(value); layout_set = true; }
+            else if (key == "--weight") { weight = std::stof(value); }
+            else if (key == "--anytime") { anytime_ms = std::stoi(value); }
+            else if (key == "--sizes") { bench.sizes = bench.sweep_sizes = parse_int_list(value); }
+            else if (key == "--seed") { bench.seed = static_cast<unsigned>(std::stoul(value)); }
+            else if (key == "--repeats") { bench.repeats = std::max(1, std::stoi(value)); }
+            else if (key == "--edits") { bench.edits = std::max(1, std::stoi(value)); }
+            else if (key == "--engine") { engine = value; }
+            else if (key == "--cost") { cost = value; }
+            else if (key == "--weights") { weights = value; }
+            else if (key == "--pages") { pages = util::parse_page_mode(value); bench.pages = pages; }
+            else if (key == "--external") { external_mb = value.empty() ? 1024 : std::max(1, std::stoi(value)); }
+            else if (key == "--prune") { prune = true; }
+            else if (key == "--format") { format = value; }
+            else if (key == "--render") { render = value; }
+            else if (key == "--batch") { batch = value; }
+            else if (key == "--daemon") { daemon = value.empty() ? default_socket_path : value; }
+            else if (key == "--queue") { queue = parse_queue(value); }
+            else if (key == "--goals") { goals = value; }
+            else if (key == "--field") { field = true; field_path = value; }
+            else if (key == "--from") { from = parse_int_list(value); }
+            else if (key == "--kpaths") { kpaths = std::max(1, std::stoi(value)); bench.kpaths = kpaths; }
+            else if (key == "--queues")
+            {
+                bench.queues.clear();
+                for (const std::string& item : parse_list(value))
+                    bench.queues.push_back(parse_queue(item));
+            }
+            else if (key == "--out") { bench.out = value; }
+            else if (key == "--baseline") { bench.baseline = value; }
+            else if (key == "--threshold") { bench.threshold = std::stof(value); }
+            else if (key == "--floor") { bench.floor_ms = std::stod(value); }
+            else if (key == "--cluster") { bench.cluster = std::max(4, std::stoi(value)); }
+            else if (key == "--engines") { bench.engines = parse_list(value); }
+            else if (key == "--threads") { bench.threads = parse_int_list(value); }
+            else if (key == "--families")
+            {
+                bench.families.clear();
+                for (const std::string& item : parse_list(value))
+                    bench.families.push_back(parse_family(item));
+            }
+            else { throw std::invalid_argument("Unknown option: " + arg); }
         }
-    }
 
-    switch (t.type)
-    {
-    case tile_e::empty: return '.';
-    case tile_e::wall: return '#';
-    case tile_e::start: return 'S';
-    case tile_e::end: return 'E';
-    default: return '?';
-    }
-}
-
-int maze_t::heuristic(const tile_t& a, const tile_t& b)
-{
-    // Compute Manhattan distance
-    int manhattan_dist = std::abs(a.pos.x - b.pos.x) + std::abs(a.pos.y - b.pos.y);
-
-    // Check if the path is straight
-    bool is_straight_path = (a.pos.x == b.pos.x || a.pos.y == b.pos.y);
-
-    // Determine desired direction to align with the goal
-    dir_e desired_dir =
-        (a.pos.x < b.pos.x) ? dir_e::e :
-        (a.pos.x > b.pos.x) ? dir_e::w :
-        (a.pos.y < b.pos.y) ? dir_e::s :
-        dir_e::n;
-
-    // Calculate rotation cost if the current direction doesn't match the desired one
-    int rotation_cost = (a.state.dir != desired_dir) ? 1000 : 0;
-
-    // Add a base rotation cost if the path is not straight
-    if (!is_straight_path)
-        rotation_cost += 1000;
-
-    // Return the total heuristic
-    return manhattan_dist + rotation_cost;
-}
-
-void maze_t::load(const char* filepath)
-{
-    const std::vector<std::string> lines = util::read_file(filepath);
-
-    size.y = static_cast<int>(lines.size());
-    size.x = static_cast<int>(lines[0].size());
-
-    for (const auto& l : lines)
-    {
-        if (l.size() != static_cast<size_t>(size.x))
+        if (benchmark == "incremental")
         {
-            throw std::runtime_error("Inconsistent row lengths in maze file.");
+            return run_incremental_bench(bench);
         }
-    }
-
-    map = new tile_t[size.x * size.y];
-
-    for (int y = 0; y < size.y; ++y)
-    {
-        for (int x = 0; x < size.x; ++x)
+        else if (benchmark == "engines")
         {
-            auto& t = get(x, y);
-            t = tile_t{ char_to_tile(lines[y][x]), ivec2{x, y}, dir_e::none, 0, 0 };
-
-            if (t.type == tile_e::invalid)
-                throw std::invalid_argument("Invalid character in maze file.");
+            return run_engine_bench(bench);
+        }
+        else if (benchmark == "sweep")
+        {
+            return run_sweep_bench(bench);
+        }
+        else if (benchmark == "queues")
+        {
+            return run_queue_bench(bench);
+        }
+        else if (benchmark == "field")
+        {
+            return run_field_bench(bench);
+        }
+        else if (benchmark == "kpaths")
+        {
+            return run_kpaths_bench(bench);
+        }
+        else if (benchmark == "queries")
+        {
+            return run_query_bench(bench);
+        }
+        else if (benchmark == "hierarchy")
+        {
+            return run_hierarchy_bench(bench);
+        }
+        else if (benchmark == "layout")
+        {
+            if (layout_set)
+                bench.layouts = { layout_e::row_major, layout };
+            return run_bench(bench);
+        }
+        else if (!benchmark.empty())
+        {
+            throw std::invalid_argument("Unknown benchmark: " + benchmark);
         }
-    }
-}
 
-void maze_t::unload()
-{
-    delete[] map;
-}
+        if (format != "grid" && format != "path")
+            throw std::invalid_argument("Unknown output format: " + format);
 
-void maze_t::print(const char* filepath) const
-{
-    std::ostringstream oss;
-    oss << "Dimensions: " << size.x << " x " << size.y << std::endl;
-    oss << "Best path cost " << path_cost << " points" << std::endl;
-    oss << "Solved in: " << solve_time << " ms. Search count: " << search_count;
-#if DEBUG_BUILD
-    oss << " (debug build)" << std::endl;
+        if (!daemon.empty())
+        {
+#if MAZE_DAEMON
+            solver_daemon_t server(daemon, bench.threads.back());
+            server.run();
+            return 0;
 #else
-    oss << " (release build)" << std::endl;
+            throw std::runtime_error("The daemon needs Unix domain sockets.");
 #endif
+        }
 
-    // Short output for console
-    std::cout << oss.str();
-
-    // Full output for file
-    for (int y = 0; y < size.y; ++y)
-    {
-        for (int x = 0; x < size.x; ++x)
+        if (!batch.empty())
         {
-            const auto& t = get(x, y);
-            char c = tile_to_char(t);
-            oss << c;
+            batch_options_t options{};
+            options.layout = layout;
+            options.format = format;
+            options.prune = prune;
+            return run_batch(read_batch_list(batch.c_str()), options);
         }
-        oss << '\n';
-    }
-
-    util::write_file(filepath, oss.str());
-}
 
-void maze_t::solve()
-{
-    // Reset map state
-    solve_time = 0;
-    search_count = 1;
-    path_cost = -1;
-
-    util::stopwatch_t sw{};
-    sw.start();
-
-    // Locate the start and end tiles
-    int start_idx = -1, end_idx = -1;
-    for (int i = 0; i < size.x * size.y; ++i)
-    {
-        map[i].state.reset();
-        if (map[i].type == tile_e::start) { start_idx = i; }
-        if (map[i].type == tile_e::end) { end_idx = i; }
-    }
-
-    if (start_idx == -1 || end_idx == -1)
-    {
-        throw std::runtime_error("Maze must have a start (S) and an end (E).");
-    }
-
-    // Priority queue for A* search
-    auto priority_fn = [&](int a, int b) { return map[a].state > map[b].state; };
-    std::priority_queue<int, std::vector<int>, decltype(priority_fn)> pq(priority_fn);
-
-    // Initialize A* with the starting tile
-    tile_t& start_tile = map[start_idx];
-    start_tile.state.dir = dir_e::e;
-
-    pq.push(start_idx);
-    while (!pq.empty())
-    {
-        int current_idx = pq.top();
-        pq.pop();
+        const std::string input = positional.size() > 0 ? positional[0] : WD"/input.txt";
+        const std::string output = positional.size() > 1 ? positional[1] : WD"/output.txt";
+
+        if (cost != "puzzle" && (anytime_ms >= 0 || !engine.empty()))
+            throw std::invalid_argument("Only the default solver takes a cost model.");
+        if ((cost == "weighted") != !weights.empty())
+            throw std::invalid_argument("--cost=weighted and --weights=FILE go together.");
+        if (queue != queue_e::binary && (anytime_ms >= 0 || !engine.empty() || external_mb >= 0))
+            throw std::invalid_argument("Only the default solver takes a queue.");
+        if (!goals.empty() && goals != "nearest" && goals != "all")
+            throw std::invalid_argument("Unknown goal mode: " + goals);
+        if (field && (anytime_ms >= 0 || !engine.empty() || external_mb >= 0 || cost != "puzzle" || weight != 1.0f || !goals.empty()))
+            throw std::invalid_argument("The distance field holds exact costs under the puzzle's model.");
+        if (!from.empty() && (!field || from.size() != 2))
+            throw std::invalid_argument("--from=X,Y picks a start for --field.");
+        if (!goals.empty() && (anytime_ms >= 0 || !engine.empty() || external_mb >= 0 || cost != "puzzle" || weight != 1.0f))
+            throw std::invalid_argument("Multi-goal search runs exact A* with the puzzle's costs.");
+
+        if (external_mb >= 0)
+        {
+            // The grid and search state stay on disk next to the output, only a bounded
+            // number of state blocks is ever in memory
+            if (cost != "puzzle" || anytime_ms >= 0 || !engine.empty() || weight != 1.0f)
+                throw std::invalid_argument("The external solver only runs exact A* with the puzzle's costs.");
 
-        tile_t& current = map[current_idx];
+            // The grid file goes however the solve ends, after the mapping below is gone
+            struct remove_file_t
+            {
+                std::string path;
+                ~remove_file_t() { std::remove(path.c_str()); }
+            } grid_file{ output + ".grid" };
+
+            external_grid_t::convert(input.c_str(), grid_file.path.c_str());
+            external_grid_t grid(grid_file.path.c_str());
+            external_solver_t solver(grid, output + ".state", (std::size_t)external_mb << 20);
+            if (solver.solve() < 0)
+                std::cerr << "No path found to the goal." << std::endl;
+            solver.print(input.c_str(), output.c_str());
+            return 0;
+        }
 
-        // If we reached the end, return the cost
-        if (current_idx == end_idx)
+        maze_t maze{};
+        maze.tile_arena.set_pages(pages);
+        maze.search_arena.set_pages(pages);
+        maze.load(input.c_str(), layout);
+        if (prune)
+            maze.prune();
+        if (!weights.empty())
+            maze.load_weights(weights.c_str());
+
+        if (kpaths > 0)
         {
-            path_cost = current.state.g_cost;
-            break;
+            if (cost != "puzzle" || anytime_ms >= 0 || !engine.empty() || !goals.empty() || weight != 1.0f)
+                throw std::invalid_argument("k shortest paths run exact with the puzzle's costs.");
+
+            kpaths_solver_t solver(maze);
+            const std::vector<route_t> routes = solver.solve(kpaths);
+            if (routes.empty())
+                std::cerr << "No path found to the goal." << std::endl;
+            write_routes(maze, routes, solver.build_time() + solver.solve_time(), output.c_str());
+            maze.unload();
+            return 0;
         }
 
-        // Explore neighboring tiles
-        for (int move_dir = 0; move_dir < 4; ++move_dir)
+        if (!render.empty())
         {
-            ivec2 n = current.pos + state_t::moves[move_dir];
-
-            // Ensure the move is within bounds
-            if (n.x < 0 || n.x >= size.x || n.y < 0 || n.y >= size.y)
-                continue;
-
-            int neighbor_idx = idx(n.x, n.y);
-            tile_t& neighbor = map[neighbor_idx];
-
-            // Skip walls
-            if (neighbor.type == tile_e::wall)
-                continue;
-
-            // Calculate the cost of moving to this neighbor
-            int move_cost = current.state.dir != static_cast<dir_e>(move_dir) ? 1001 : 1;
-            int g_cost = current.state.g_cost + move_cost;
+            render_compact_path(maze, render.c_str());
+            maze.print(output.c_str());
+            maze.unload();
+            return 0;
+        }
 
-            // If we found a cheaper path to this neighbor, update it
-            if (neighbor.state.g_cost == 0 || g_cost < neighbor.state.g_cost)
+        if (anytime_ms >= 0)
+        {
+            // Start inflated unless a weight was given, then tighten while time remains
+            anytime_solver_t solver(maze);
+            util::stopwatch_t sw{};
+            const anytime_report_t result = solver.solve(weight > 1.0f ? weight : 3.0f, 0.5f, anytime_ms,
+                [](const anytime_report_t& r)
+                {
+                    std::cout << "Weight " << r.weight << ": cost " << r.cost << ", bound " << r.bound
+                        << " (" << r.expanded << " expanded, " << r.elapsed_ms << " ms)" << std::endl;
+                });
+            solver.mark_path(result, sw.elapsed_ms());
+        }
+        else if (!engine.empty())
+        {
+            find_engine(engine).run(maze, bench.threads.empty() ? 0 : bench.threads.back());
+        }
+        else if (field)
+        {
+            // A saved field is reused as long as it matches the maze, otherwise rebuilt and saved
+            distance_field_t distances(maze);
+            const bool exists = !field_path.empty() && std::ifstream(field_path).good();
+            const bool loaded = exists && distances.load(field_path.c_str());
+            if (exists && !loaded)
+                std::cout << "Distance field in " << field_path << " doesn't match this maze, rebuilding" << std::endl;
+            if (!loaded)
+                distances.build();
+            if (!field_path.empty() && !loaded)
+                distances.save(field_path.c_str());
+            std::cout << (loaded ? "Loaded" : "Built") << " distance field (" << util::format_bytes(distances.bytes())
+                << ") in " << distances.build_time() << " ms" << std::endl;
+
+            std::size_t start = maze.start_idx;
+            if (!from.empty())
             {
-                neighbor.state.dir = static_cast<dir_e>(move_dir); // Track direction
-                neighbor.state.g_cost = g_cost;
-                neighbor.state.h_cost = heuristic(neighbor, map[end_idx]);
-                neighbor.state.p_idx = current_idx;
-                pq.push(neighbor_idx);
-                search_count++;
+                if (from[0] < 0 || from[0] >= maze.size.x || from[1] < 0 || from[1] >= maze.size.y ||
+                    maze.map[maze.idx(from[0], from[1])].type == tile_e::wall)
+                    throw std::invalid_argument("--from must name an open tile.");
+                start = maze.idx(from[0], from[1]);
             }
-        }
-    }
+            if (start == maze_t::npos)
+                throw std::runtime_error("Maze must have a start (S) and an end (E).");
 
-    // Update solve time
-    solve_time = sw.elapsed_ms();
-
-    // Ensure we found a valid path
-    if (path_cost == -1)
-    {
-        std::cerr << "No path found to the goal." << std::endl;
-    }
-    // Format map to only show valid path
-    else
-    {
-        int curr_idx = end_idx;
-        while (true)
+            const solve_result_t result = distances.answer(start, (int)dir_e::e);
+            if (!result.found())
+                std::cerr << "No path found to the goal." << std::endl;
+            maze.apply(result);
+        }
+        else if (!goals.empty())
         {
-            map[curr_idx].state.dir = (dir_e)((int)map[curr_idx].state.dir | (int)dir_e::path);
-            curr_idx = map[curr_idx].state.p_idx;
+            // Every S at once, to the nearest E or to each of them
+            const solve_result_t result = maze.multi_query(goals == "all", maze.search_arena, queue);
+            if (!result.found())
+                std::cerr << "No path found to the goal." << std::endl;
+            for (std::size_t g = 0; g < result.goal_costs.size(); ++g)
+            {
+                const ivec2 pos = maze.map[maze.ends[g]].pos;
+                std::cout << "E at " << pos.x << "," << pos.y << ": " << result.goal_costs[g] << std::endl;
+            }
+            maze.apply(result);
 
-            if (curr_idx == start_idx)
-                break;
+            // The path may join any S to any E, so it is written from the result, not the marks
+            if (format == "path")
+            {
+                write_compact_path(maze, result.path, output.c_str());
+                maze.unload();
+                return 0;
+            }
         }
-    }
-}
-
-int main(int argc, char** args)
-{
-    /*
-    * Example 1: 7036
-    * Example 2: 11048
-    * Input: 107476
-    */
-
-    try
-    {
-        maze_t maze{};
-        maze.load(WD"/input.txt");
-        maze.solve();
-        maze.print(WD"/output.txt");
+        else if (cost == "puzzle") { maze.solve<puzzle_cost_t>(weight, queue); }
+        else if (cost == "strict") { maze.solve<strict_cost_t>(weight, queue); }
+        else if (cost == "uniform") { maze.solve<uniform_cost_t>(weight, queue); }
+        else if (cost == "weighted") { maze.solve<weighted_cost_t>(weight, queue); }
+        else { throw std::invalid_argument("Unknown cost model: " + cost); }
+
+        if (format == "path") { write_compact_path(maze, output.c_str()); }
+        else { maze.print(output.c_str()); }
         maze.unload();
     }
     catch (const std::exception& e)
@@ -0,0 +1,1186 @@
+#pragma once
+
+#include <util.hpp>
+#include <layout.hpp>
+#include <queue.hpp>
+
+#include <queue>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <array>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MAZE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(MAZE_SSE2) && (defined(__AVX2__) || defined(__GNUC__) || defined(__clang__))
+#define MAZE_AVX2 1
+#include <immintrin.h>
+#endif
+
+using u8 = unsigned char;
+using cost_t = std::int64_t;
+enum struct tile_e : u8 { invalid, empty, wall, start, end, dead };
+enum struct dir_e : u8 { n, s, e, w, none, path = 0xF0 };
+
+struct ivec2
+{
+    int x{ 0 }, y{ 0 };
+    inline ivec2 operator+(const ivec2& o) const { return ivec2{ x + o.x, y + o.y }; }
+    inline ivec2 operator-(const ivec2& o) const { return ivec2{ x - o.x, y - o.y }; }
+};
+
+struct state_t
+{
+    static constexpr ivec2 moves[] =
+    {
+        ivec2{ 0, -1},   // North
+        ivec2{ 0,  1},   // South
+        ivec2{ 1,  0},   // East
+        ivec2{-1,  0}    // West
+    };
+
+    dir_e dir{ dir_e::none };
+    cost_t g_cost{ 0 };
+    cost_t h_cost{ 0 };
+    std::size_t p_idx{ 0 };     // Parent (tile, facing) state, see state_id()
+
+    inline cost_t f_cost() const { return g_cost + h_cost; }
+    inline bool operator>(const state_t& other) const
+    {
+        if (f_cost() == other.f_cost())
+            return h_cost > other.h_cost;
+        return f_cost() > other.f_cost();
+    }
+
+    inline void reset()
+    {
+        dir = dir_e::none;
+        g_cost = 0;
+        h_cost = 0;
+        p_idx = 0;
+    }
+};
+
+struct tile_t
+{
+    tile_e type{ tile_e::empty };
+    dir_e dir{ dir_e::none };   // Direction the best path enters by, OR-ed with dir_e::path
+    u8 weight{ 0 };             // Extra cost of entering, only weighted cost models read it
+    u8 exits{ 0 };              // Bit d set when the neighbour in direction d is open, see maze_t::set_type
+    ivec2 pos{ 0, 0 };
+};
+
+// A cost model is a stateless policy the solver takes as a template parameter, so every model
+// gets its own instantiation with the constants folded into the inner loop. Moving one tile
+// costs Step, plus Turn for a 90 degree change of direction or Reverse for a 180 degree one.
+// Weighted models also charge the weight of the tile being entered.
+template <std::int64_t Step, std::int64_t Turn, std::int64_t Reverse = Turn, bool Weighted = false>
+struct cost_model_t
+{
+    static constexpr cost_t step = Step;
+    static constexpr cost_t turn = Turn;
+    static constexpr cost_t reverse = Reverse;
+    static constexpr bool weighted = Weighted;
+
+    // Move costs indexed by facing * 4 + dir, so the hot loop does a lookup instead of compares
+    static constexpr std::array<cost_t, 16> moves = []
+    {
+        std::array<cost_t, 16> table{};
+        for (int f = 0; f < 4; ++f)
+            for (int d = 0; d < 4; ++d)
+                table[f * 4 + d] = Step + (f == d ? 0 : (f ^ d) == 1 ? Reverse : Turn);
+        return table;
+    }();
+
+    static constexpr cost_t move(int facing, int dir) { return moves[facing * 4 + dir]; }
+    static constexpr cost_t enter(const tile_t& t) { return Weighted ? static_cast<cost_t>(t.weight) : 0; }
+};
+
+using puzzle_cost_t = cost_model_t<1, 1000>;            // The puzzle's rules
+using strict_cost_t = cost_model_t<1, 1000, 2000>;      // Turning around takes two rotations
+using uniform_cost_t = cost_model_t<1, 0>;              // Plain shortest path, turns are free
+using weighted_cost_t = cost_model_t<1, 1000, 1000, true>;  // The puzzle's, plus tile weights from load_weights()
+
+// The graph every search runs on: one node per (tile, facing) pair, where facing is the
+// direction of the last move. Edge costs come from a cost model, the engines other than
+// maze_t::solve use the puzzle's. The start node is S facing east, any facing on E is a goal.
+static constexpr cost_t step_cost = puzzle_cost_t::step;
+static constexpr cost_t turn_cost = puzzle_cost_t::turn;
+static constexpr cost_t infinite_cost = std::numeric_limits<cost_t>::max() / 4;
+static constexpr int facings = 4;
+
+inline std::size_t state_id(std::size_t tile, int facing) { return tile * facings + facing; }
+inline std::size_t state_tile(std::size_t state) { return state / facings; }
+inline int state_facing(std::size_t state) { return static_cast<int>(state % facings); }
+inline int opposite(int dir) { return dir ^ 1; }
+
+inline cost_t move_cost(int facing, int dir)
+{
+    return puzzle_cost_t::move(facing, dir);
+}
+
+struct scan_result_t
+{
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    std::vector<std::size_t> newlines{};
+    std::size_t start{ npos };
+    std::size_t end{ npos };
+    std::size_t invalid{ npos };
+};
+
+// What a search found, kept apart from the maze so the maze stays read-only while searching
+// and any number of queries can run on it at once
+struct solve_result_t
+{
+    cost_t cost{ -1 };                  // -1 when E is unreachable
+    float bound{ 1.0f };                // The cost is at most this many times the optimum
+    std::vector<std::size_t> path{};    // (tile, facing) states from S to E, see state_id()
+    int solve_time{ 0 };
+    std::size_t pushed{ 0 };            // States queued, what print() reports as the search count
+    std::size_t expanded{ 0 };
+    std::size_t peak_open{ 0 };
+    std::size_t state_bytes{ 0 };       // Search records, one per (tile, facing)
+    std::size_t open_bytes{ 0 };        // Open list, including the buffers it outgrew
+    std::vector<cost_t> goal_costs{};   // Per goal in maze_t::ends order, -1 when unreachable; every-goal queries only
+
+    inline bool found() const { return cost >= 0; }
+};
+
+// Where a search starts and what it looks for. Every start is seeded facing east and the search
+// ends at the first goal popped, the nearest one, unless every_goal asks for the cost of each.
+struct endpoints_t
+{
+    const std::size_t* starts{ nullptr };
+    std::size_t start_count{ 0 };
+    const std::size_t* goals{ nullptr };
+    std::size_t goal_count{ 0 };
+    bool every_goal{ false };
+};
+
+struct maze_t
+{
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);   // No such tile
+
+    ivec2 size{ 0, 0 };
+    layout_t layout{};
+    tile_t* map{ nullptr };
+    std::uint32_t* component{ nullptr };    // Connected-component label per tile, null when unknown
+    int solve_time{ 0 };
+    int search_count{ 0 };
+    cost_t path_cost{ 0 };
+    float path_bound{ 1.0f };
+    std::size_t start_idx{ npos };      // First S in the file, the start of every single-pair search
+    std::size_t end_idx{ npos };        // First E in the file
+    std::vector<std::size_t> starts{};  // Every S, in file order
+    std::vector<std::size_t> ends{};    // Every E, in file order
+    std::array<std::ptrdiff_t, 4> offsets{};  // Index delta per direction, row-major layouts only
+    std::size_t open_count{ 0 };    // Open tiles found by the last prune()
+    std::size_t pruned{ 0 };        // Of those, tiles prune() turned into dead
+    std::size_t components{ 0 };    // Connected open regions found by label_components()
+    std::size_t state_bytes{ 0 };   // Memory the last solve() used, see solve_result_t
+    std::size_t open_bytes{ 0 };
+    std::size_t peak_open{ 0 };
+    util::arena_t tile_arena{};     // Backs map; unload() rewinds it so the next load reuses the pages
+    util::arena_t search_arena{};   // Scratch for parsing and solve(), rewound at the start of each
+
+    static constexpr std::uint32_t no_component = std::numeric_limits<std::uint32_t>::max();
+
+    // Up to this many goals the heuristic is the nearest goal's, past it searches are Dijkstra
+    static constexpr std::size_t multi_heuristic_goals = 8;
+
+    inline std::size_t idx(int x, int y) const { return layout.idx(x, y); }
+    inline std::size_t capacity() const { return layout.capacity(); }
+    inline tile_t& get(int x, int y) { return map[idx(x, y)]; }
+    inline const tile_t& get(int x, int y) const { return map[idx(x, y)]; }
+    inline std::size_t grid_bytes() const { return capacity() * (sizeof(tile_t) + (component ? sizeof(std::uint32_t) : 0)); }
+    inline bool is_open(std::size_t i) const { return map[i].type != tile_e::wall && map[i].type != tile_e::dead; }
+
+    // False only when the labels prove no path joins the two tiles
+    inline bool connected(std::size_t a, std::size_t b) const { return component == nullptr || component[a] == component[b]; }
+
+    // Index of the tile one step from i in direction d, or -1 when that leaves the grid
+    inline std::ptrdiff_t neighbor(std::size_t i, int d) const
+    {
+        const ivec2 n = map[i].pos + state_t::moves[d];
+        if (n.x < 0 || n.x >= size.x || n.y < 0 || n.y >= size.y)
+            return -1;
+        return static_cast<std::ptrdiff_t>(idx(n.x, n.y));
+    }
+
+    // Index of the neighbour in direction d, which has to be inside the grid. Searches take d
+    // from the tile's exit mask, so the bounds and wall checks are already done:
+    //   for (unsigned m = map[i].exits; m != 0; m &= m - 1) { const int d = ...; step(i, d); }
+    inline std::size_t step(std::size_t i, int d) const
+    {
+        if (layout.kind == layout_e::row_major)
+            return static_cast<std::size_t>(static_cast<std::ptrdiff_t>(i) + offsets[d]);
+        const ivec2 n = map[i].pos + state_t::moves[d];
+        return idx(n.x, n.y);
+    }
+
+    static constexpr tile_e char_to_tile(char c);
+    static constexpr char tile_to_char(const tile_t& t);
+    static void classify(const char* src, std::size_t n, u8* dst, scan_result_t& result);
+    
+    template <typename Model = puzzle_cost_t>
+    static cost_t heuristic(const ivec2& from, int facing, const ivec2& to);
+
+    void load(const char* filepath, layout_e kind = layout_e::row_major);
+    void parse(const std::string& text, layout_e kind = layout_e::row_major);
+    void load_weights(const char* filepath);
+    void unload();
+    void set_type(std::size_t i, tile_e type);
+    void label_components();
+    float prune();
+
+    float bytes_per_tile() const;
+    std::string header() const;
+    void print(const char* filepath) const;
+    template <typename Model = puzzle_cost_t, template <typename> class Queue = binary_heap_t>
+    solve_result_t search(float weight, util::arena_t& scratch, const endpoints_t& endpoints) const;
+    template <typename Model = puzzle_cost_t>
+    solve_result_t search(float weight, util::arena_t& scratch, const endpoints_t& endpoints, queue_e queue) const;
+    template <typename Model = puzzle_cost_t>
+    solve_result_t query(float weight, util::arena_t& scratch, queue_e queue = queue_e::binary) const;
+    template <typename Model = puzzle_cost_t>
+    solve_result_t query(float weight = 1.0f, queue_e queue = queue_e::binary) const;
+    template <typename Model = puzzle_cost_t>
+    solve_result_t multi_query(bool every_goal, util::arena_t& scratch, queue_e queue = queue_e::binary) const;
+    void apply(const solve_result_t& result);
+
+    template <typename Model = puzzle_cost_t>
+    void solve(float weight = 1.0f, queue_e queue = queue_e::binary);
+    void mark_path(const state_t* states, std::size_t goal_state);
+};
+
+constexpr tile_e maze_t::char_to_tile(char c)
+{
+    switch (c) {
+    case '.': return tile_e::empty;
+    case '#': return tile_e::wall;
+    case 'S': return tile_e::start;
+    case 'E': return tile_e::end;
+    default: return tile_e::invalid;
+    }
+}
+
+constexpr char maze_t::tile_to_char(const tile_t& t)
+{
+    const dir_e masked_dir = (dir_e)((int)t.dir ^ (int)dir_e::path);
+    const bool is_path = ((int)t.dir & (int)dir_e::path) > 0;
+
+    if (is_path && t.type != tile_e::start && t.type != tile_e::end)
+    {
+        switch (masked_dir)
+        {
+        case dir_e::n: return '^';
+        case dir_e::s: return 'v';
+        case dir_e::e: return '>';
+        case dir_e::w: return '<';
+        default: return '?';
+        }
+    }
+
+    switch (t.type)
+    {
+    case tile_e::empty: return '.';
+    case tile_e::dead: return '.';
+    case tile_e::wall: return '#';
+    case tile_e::start: return 'S';
+    case tile_e::end: return 'E';
+    default: return '?';
+    }
+}
+
+// Manhattan distance plus the fewest turns any path from this facing has to make.
+// Admissible and consistent, so A* is exact and LPA* can rely on it.
+template <typename Model>
+inline cost_t maze_t::heuristic(const ivec2& from, int facing, const ivec2& to)
+{
+    const int dx = to.x - from.x;
+    const int dy = to.y - from.y;
+
+    // Directions any path to the goal has to travel in
+    const int need_x = dx > 0 ? (int)dir_e::e : dx < 0 ? (int)dir_e::w : -1;
+    const int need_y = dy > 0 ? (int)dir_e::s : dy < 0 ? (int)dir_e::n : -1;
+
+    // Facing the opposite way costs two turns or one reversal, whichever the model makes cheaper
+    constexpr cost_t about_face = std::min(2 * Model::turn, Model::reverse);
+
+    cost_t turning = 0;
+    if (need_x >= 0 && need_y >= 0)
+    {
+        turning = (facing == need_x || facing == need_y) ? Model::turn : Model::turn + std::min(Model::turn, Model::reverse);
+    }
+    else if (need_x >= 0 || need_y >= 0)
+    {
+        const int need = std::max(need_x, need_y);
+        turning = facing == need ? 0 : facing == opposite(need) ? about_face : Model::turn;
+    }
+
+    return (std::abs(dx) + std::abs(dy)) * Model::step + turning;
+}
+
+// Scalar reference kernel, also used for the tail the vector kernels leave behind
+static void classify_scalar(const char* src, std::size_t begin, std::size_t n, u8* dst, scan_result_t& r)
+{
+    for (std::size_t i = begin; i < n; ++i)
+    {
+        const char c = src[i];
+        if (c == '\n')
+        {
+            dst[i] = 0;
+            r.newlines.push_back(i);
+            continue;
+        }
+
+        // A carriage return is part of a CRLF line ending, anywhere else it is invalid
+        if (c == '\r' && i + 1 < n && src[i + 1] == '\n')
+        {
+            dst[i] = 0;
+            continue;
+        }
+
+        const tile_e t = maze_t::char_to_tile(c);
+        dst[i] = static_cast<u8>(t);
+
+        if (t == tile_e::invalid && r.invalid == scan_result_t::npos) { r.invalid = i; }
+        if (t == tile_e::start && r.start == scan_result_t::npos) { r.start = i; }
+        if (t == tile_e::end && r.end == scan_result_t::npos) { r.end = i; }
+    }
+}
+
+// Records newline, start, end and invalid positions for one block of movemask bits. Carriage
+// returns count as known when a newline follows, which may be the first byte of the next block.
+static inline void classify_masks(const char* src, std::size_t n, std::size_t base, std::uint32_t known, std::uint32_t full,
+    std::uint32_t nl, std::uint32_t cr, std::uint32_t s, std::uint32_t e, scan_result_t& r)
+{
+    for (; cr != 0; cr &= cr - 1)
+    {
+        const std::size_t i = base + util::count_trailing_zeros(cr);
+        if (i + 1 < n && src[i + 1] == '\n')
+            known |= cr & (0u - cr);
+    }
+
+    if (known != full && r.invalid == scan_result_t::npos)
+        r.invalid = base + util::count_trailing_zeros(~known & full);
+    if (s != 0 && r.start == scan_result_t::npos)
+        r.start = base + util::count_trailing_zeros(s);
+    if (e != 0 && r.end == scan_result_t::npos)
+        r.end = base + util::count_trailing_zeros(e);
+
+    while (nl != 0)
+    {
+        r.newlines.push_back(base + util::count_trailing_zeros(nl));
+        nl &= nl - 1;
+    }
+}
+
+#if MAZE_SSE2
+// 16 bytes per iteration: one compare per symbol, then the tile code is the OR of masked constants
+static std::size_t classify_sse2(const char* src, std::size_t n, u8* dst, scan_result_t& r)
+{
+    const __m128i dot = _mm_set1_epi8('.'), hash = _mm_set1_epi8('#');
+    const __m128i s_ch = _mm_set1_epi8('S'), e_ch = _mm_set1_epi8('E'), nl_ch = _mm_set1_epi8('\n');
+    const __m128i cr_ch = _mm_set1_epi8('\r');
+    const __m128i empty = _mm_set1_epi8((char)tile_e::empty), wall = _mm_set1_epi8((char)tile_e::wall);
+    const __m128i start = _mm_set1_epi8((char)tile_e::start), end = _mm_set1_epi8((char)tile_e::end);
+
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i is_dot = _mm_cmpeq_epi8(v, dot);
+        const __m128i is_hash = _mm_cmpeq_epi8(v, hash);
+        const __m128i is_s = _mm_cmpeq_epi8(v, s_ch);
+        const __m128i is_e = _mm_cmpeq_epi8(v, e_ch);
+        const __m128i is_nl = _mm_cmpeq_epi8(v, nl_ch);
+
+        const __m128i code = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(is_dot, empty), _mm_and_si128(is_hash, wall)),
+            _mm_or_si128(_mm_and_si128(is_s, start), _mm_and_si128(is_e, end)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), code);
+
+        const __m128i known = _mm_or_si128(_mm_or_si128(is_dot, is_hash),
+            _mm_or_si128(_mm_or_si128(is_s, is_e), is_nl));
+
+        classify_masks(src, n, i, (std::uint32_t)_mm_movemask_epi8(known), 0xFFFFu,
+            (std::uint32_t)_mm_movemask_epi8(is_nl),
+            (std::uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, cr_ch)),
+            (std::uint32_t)_mm_movemask_epi8(is_s),
+            (std::uint32_t)_mm_movemask_epi8(is_e), r);
+    }
+    return i;
+}
+#endif
+
+#if MAZE_AVX2
+// Same as the SSE2 kernel over 32 bytes, compiled for AVX2 regardless of the baseline flags
+#if !defined(_MSC_VER)
+__attribute__((target("avx2")))
+#endif
+static std::size_t classify_avx2(const char* src, std::size_t n, u8* dst, scan_result_t& r)
+{
+    const __m256i dot = _mm256_set1_epi8('.'), hash = _mm256_set1_epi8('#');
+    const __m256i s_ch = _mm256_set1_epi8('S'), e_ch = _mm256_set1_epi8('E'), nl_ch = _mm256_set1_epi8('\n');
+    const __m256i cr_ch = _mm256_set1_epi8('\r');
+    const __m256i empty = _mm256_set1_epi8((char)tile_e::empty), wall = _mm256_set1_epi8((char)tile_e::wall);
+    const __m256i start = _mm256_set1_epi8((char)tile_e::start), end = _mm256_set1_epi8((char)tile_e::end);
+
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i is_dot = _mm256_cmpeq_epi8(v, dot);
+        const __m256i is_hash = _mm256_cmpeq_epi8(v, hash);
+        const __m256i is_s = _mm256_cmpeq_epi8(v, s_ch);
+        const __m256i is_e = _mm256_cmpeq_epi8(v, e_ch);
+        const __m256i is_nl = _mm256_cmpeq_epi8(v, nl_ch);
+
+        const __m256i code = _mm256_or_si256(
+            _mm256_or_si256(_mm256_and_si256(is_dot, empty), _mm256_and_si256(is_hash, wall)),
+            _mm256_or_si256(_mm256_and_si256(is_s, start), _mm256_and_si256(is_e, end)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), code);
+
+        const __m256i known = _mm256_or_si256(_mm256_or_si256(is_dot, is_hash),
+            _mm256_or_si256(_mm256_or_si256(is_s, is_e), is_nl));
+
+        classify_masks(src, n, i, (std::uint32_t)_mm256_movemask_epi8(known), 0xFFFFFFFFu,
+            (std::uint32_t)_mm256_movemask_epi8(is_nl),
+            (std::uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, cr_ch)),
+            (std::uint32_t)_mm256_movemask_epi8(is_s),
+            (std::uint32_t)_mm256_movemask_epi8(is_e), r);
+    }
+    return i;
+}
+
+static bool has_avx2()
+{
+#if defined(__AVX2__)
+    return true;
+#elif defined(_MSC_VER)
+    return false;
+#else
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#endif
+}
+#endif
+
+inline void maze_t::classify(const char* src, std::size_t n, u8* dst, scan_result_t& result)
+{
+    std::size_t done = 0;
+#if MAZE_AVX2
+    if (has_avx2())
+        done = classify_avx2(src, n, dst, result);
+#endif
+#if MAZE_SSE2
+    if (done == 0)
+        done = classify_sse2(src, n, dst, result);
+#endif
+    classify_scalar(src, done, n, dst, result);
+}
+
+inline void maze_t::load(const char* filepath, layout_e kind)
+{
+    parse(util::read_file_bytes(filepath), kind);
+}
+
+inline void maze_t::parse(const std::string& text, layout_e kind)
+{
+    search_arena.reset();
+    const util::arena_allocator_t<u8> scratch(search_arena);
+
+    // Classify every byte into a tile code in one pass
+    util::arena_vector_t<u8> codes(text.size(), scratch);
+    scan_result_t scan{};
+    classify(text.data(), text.size(), codes.data(), scan);
+
+    if (scan.invalid != scan_result_t::npos)
+        throw std::invalid_argument("Invalid character in maze file.");
+
+    // Split rows at the newlines, skipping empty lines. A CRLF ending is the same as LF.
+    util::arena_vector_t<std::size_t> rows(scratch);
+    std::size_t row_begin = 0;
+    scan.newlines.push_back(text.size());
+    for (std::size_t nl : scan.newlines)
+    {
+        const std::size_t row_end = (nl > row_begin && nl < text.size() && text[nl - 1] == '\r') ? nl - 1 : nl;
+        if (row_end > row_begin)
+        {
+            const std::size_t len = row_end - row_begin;
+            if (rows.empty())
+                size.x = static_cast<int>(len);
+            else if (len != static_cast<std::size_t>(size.x))
+                throw std::runtime_error("Inconsistent row lengths in maze file.");
+            rows.push_back(row_begin);
+        }
+        row_begin = nl + 1;
+    }
+
+    if (rows.empty())
+        throw std::runtime_error("File is empty.");
+
+    size.y = static_cast<int>(rows.size());
+    layout.kind = kind;
+    layout.resize(size.x, size.y);
+
+    // Map byte offsets of S and E back to tile indices
+    auto offset_to_idx = [&](std::size_t offset) -> std::size_t
+    {
+        if (offset == scan_result_t::npos)
+            return npos;
+        const auto row = std::upper_bound(rows.begin(), rows.end(), offset) - rows.begin() - 1;
+        return idx(static_cast<int>(offset - rows[row]), static_cast<int>(row));
+    };
+    start_idx = offset_to_idx(scan.start);
+    end_idx = offset_to_idx(scan.end);
+    open_count = 0;
+    pruned = 0;
+
+    tile_arena.reset();
+    map = tile_arena.allocate<tile_t>(capacity());
+
+    // Slots a blocked layout pads with are walls nothing can step into
+    if (capacity() != (std::size_t)size.x * size.y)
+    {
+        util::parallel_for(0, capacity(), std::size_t(1) << 16, [&](std::size_t begin, std::size_t end)
+        {
+            std::fill(map + begin, map + end, tile_t{ tile_e::wall, dir_e::none, 0, 0, ivec2{ -1, -1 } });
+        });
+    }
+
+    // Rows are independent, so large mazes fill them on the pool. This is also the first touch
+    // of the map, which places each band's pages on the node of the thread that filled it.
+    // Each band also lists its S and E tiles, joined in file order afterwards.
+    const std::size_t bands = ((std::size_t)size.y + 63) / 64;
+    std::vector<std::vector<std::size_t>> band_starts(bands), band_ends(bands);
+    util::parallel_for(0, (std::size_t)size.y, 64, [&](std::size_t begin, std::size_t end)
+    {
+        for (int y = (int)begin; y < (int)end; ++y)
+        {
+            const u8* row = codes.data() + rows[y];
+            for (int x = 0; x < size.x; ++x)
+            {
+                const tile_e type = static_cast<tile_e>(row[x]);
+                get(x, y) = tile_t{ type, dir_e::none, 0, 0, ivec2{x, y} };
+                if (type == tile_e::start) { band_starts[begin / 64].push_back(idx(x, y)); }
+                if (type == tile_e::end) { band_ends[begin / 64].push_back(idx(x, y)); }
+            }
+        }
+    });
+
+    starts.clear();
+    ends.clear();
+    for (std::size_t b = 0; b < bands; ++b)
+    {
+        starts.insert(starts.end(), band_starts[b].begin(), band_starts[b].end());
+        ends.insert(ends.end(), band_ends[b].begin(), band_ends[b].end());
+    }
+
+    // Exit masks, a tile at a time from its own neighbours so the bands never write each other's
+    offsets = { -(std::ptrdiff_t)size.x, (std::ptrdiff_t)size.x, 1, -1 };
+    util::parallel_for(0, (std::size_t)size.y, 64, [&](std::size_t begin, std::size_t end)
+    {
+        for (int y = (int)begin; y < (int)end; ++y)
+        {
+            for (int x = 0; x < size.x; ++x)
+            {
+                const std::size_t i = idx(x, y);
+                u8 exits = 0;
+                for (int d = 0; d < 4; ++d)
+                {
+                    const std::ptrdiff_t n = neighbor(i, d);
+                    exits |= (n >= 0 && is_open(n)) ? u8(1u << d) : u8(0);
+                }
+                map[i].exits = exits;
+            }
+        }
+    });
+
+    label_components();
+}
+
+// Changes a tile's type and keeps the exit masks of its neighbours in step
+inline void maze_t::set_type(std::size_t i, tile_e type)
+{
+    map[i].type = type;
+    const bool open = is_open(i);
+    for (int d = 0; d < 4; ++d)
+    {
+        const std::ptrdiff_t n = neighbor(i, d);
+        if (n < 0)
+            continue;
+        const u8 bit = u8(1u << opposite(d));
+        map[n].exits = open ? (map[n].exits | bit) : (map[n].exits & ~bit);
+    }
+}
+
+// Labels every non-wall tile with the component it belongs to, so a query whose endpoints sit
+// in different components is answered without searching. Union-find over bands of rows on the
+// pool, each band only linking its own tiles, then the band edges are joined in order and every
+// tile looks up its root. The label is the root's tile index. Dead tiles are labelled like empty
+// ones: filling dead ends never disconnects anything, and LPA* can revive them.
+// Labels are 32-bit tile indices, so grids of 2^32 - 1 slots or more go unlabelled and every
+// pair of tiles counts as connected.
+inline void maze_t::label_components()
+{
+    component = nullptr;
+    components = 0;
+    if (capacity() >= no_component)
+        return;
+
+    std::uint32_t* parent = search_arena.allocate<std::uint32_t>(capacity());
+    auto find = [parent](std::uint32_t i)
+    {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+    auto unite = [&](std::uint32_t a, std::uint32_t b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a != b)
+            parent[std::max(a, b)] = std::min(a, b);
+    };
+    auto passable = [&](std::size_t i) { return map[i].type != tile_e::wall; };
+
+    const std::size_t band = 64;
+    util::parallel_for(0, (std::size_t)size.y, band, [&](std::size_t begin, std::size_t end)
+    {
+        for (int y = (int)begin; y < (int)end; ++y)
+        {
+            for (int x = 0; x < size.x; ++x)
+            {
+                const std::uint32_t i = static_cast<std::uint32_t>(idx(x, y));
+                if (!passable(i))
+                    continue;
+                parent[i] = i;
+                if (x > 0 && passable(idx(x - 1, y)))
+                    unite(i, static_cast<std::uint32_t>(idx(x - 1, y)));
+                if (y > (int)begin && passable(idx(x, y - 1)))
+                    unite(i, static_cast<std::uint32_t>(idx(x, y - 1)));
+            }
+        }
+    });
+
+    for (int y = (int)band; y < size.y; y += (int)band)
+    {
+        for (int x = 0; x < size.x; ++x)
+        {
+            if (passable(idx(x, y)) && passable(idx(x, y - 1)))
+                unite(static_cast<std::uint32_t>(idx(x, y)), static_cast<std::uint32_t>(idx(x, y - 1)));
+        }
+    }
+
+    // Read-only walks from here on, the roots no longer move
+    component = tile_arena.allocate<std::uint32_t>(capacity());
+    std::atomic<std::size_t> roots{ 0 };
+    util::parallel_for(0, capacity(), std::size_t(1) << 16, [&](std::size_t begin, std::size_t end)
+    {
+        std::size_t local = 0;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            if (!passable(i))
+            {
+                component[i] = no_component;
+                continue;
+            }
+
+            std::uint32_t r = static_cast<std::uint32_t>(i);
+            while (parent[r] != r)
+                r = parent[r];
+            component[i] = r;
+            local += (r == i) ? 1 : 0;
+        }
+        roots.fetch_add(local, std::memory_order_relaxed);
+    });
+    components = roots.load(std::memory_order_relaxed);
+}
+
+// Fills dead ends. An open tile other than S and E with at most one open neighbour can only be
+// entered and left the same way, which never beats moving on directly as long as reversing
+// costs at least as much as turning, and filling it can expose the next dead end behind it.
+// Filled tiles become tile_e::dead, which is_open() rejects, so every engine skips them.
+// Components holding both an S and an E are the only ones a search can use, so once there is
+// one, the empty tiles of every other component are filled as well.
+// Returns the fraction of open tiles removed.
+inline float maze_t::prune()
+{
+    std::vector<std::uint32_t> keep;
+    if (component)
+    {
+        for (std::size_t s : starts)
+            for (std::size_t e : ends)
+                if (component[s] == component[e])
+                    keep.push_back(component[s]);
+        std::sort(keep.begin(), keep.end());
+        keep.erase(std::unique(keep.begin(), keep.end()), keep.end());
+    }
+    auto stranded = [&](std::size_t i)
+    {
+        return !keep.empty() && map[i].type == tile_e::empty && !std::binary_search(keep.begin(), keep.end(), component[i]);
+    };
+
+    auto dead_end = [&](std::size_t i)
+    {
+        const unsigned exits = map[i].exits;
+        return map[i].type == tile_e::empty && (exits & (exits - 1)) == 0;
+    };
+
+    // The first dead ends and the open count come from a scan of every row on the pool
+    const std::size_t band = 64;
+    const std::size_t bands = ((std::size_t)size.y + band - 1) / band;
+    std::vector<std::vector<std::size_t>> found(bands);
+    std::vector<std::vector<std::size_t>> cut_off(bands);
+    std::vector<std::size_t> open(bands, 0);
+    util::parallel_for(0, (std::size_t)size.y, band, [&](std::size_t begin, std::size_t end)
+    {
+        const std::size_t b = begin / band;
+        for (int y = (int)begin; y < (int)end; ++y)
+        {
+            for (int x = 0; x < size.x; ++x)
+            {
+                const std::size_t i = idx(x, y);
+                if (!is_open(i))
+                    continue;
+                ++open[b];
+                if (stranded(i))
+                    cut_off[b].push_back(i);
+                else if (dead_end(i))
+                    found[b].push_back(i);
+            }
+        }
+    });
+
+    std::vector<std::size_t> frontier;
+    open_count = pruned;
+    for (std::size_t b = 0; b < bands; ++b)
+    {
+        open_count += open[b];
+        frontier.insert(frontier.end(), found[b].begin(), found[b].end());
+        for (std::size_t i : cut_off[b])
+            set_type(i, tile_e::dead);
+        pruned += cut_off[b].size();
+    }
+
+    // Each round checks the frontier on the pool, then fills what it found and queues the
+    // open neighbours. Filling only lowers neighbour counts, so a tile found dead in a round
+    // is still dead after the others of that round are filled.
+    std::vector<u8> dead;
+    std::vector<std::size_t> next;
+    while (!frontier.empty())
+    {
+        dead.assign(frontier.size(), 0);
+        util::parallel_for(0, frontier.size(), 4096, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t k = begin; k < end; ++k)
+                dead[k] = dead_end(frontier[k]) ? 1 : 0;
+        });
+
+        next.clear();
+        for (std::size_t k = 0; k < frontier.size(); ++k)
+        {
+            const std::size_t i = frontier[k];
+            if (!dead[k] || map[i].type == tile_e::dead)
+                continue;
+
+            for (unsigned m = map[i].exits; m != 0; m &= m - 1)
+                next.push_back(step(i, util::count_trailing_zeros(m)));
+            set_type(i, tile_e::dead);
+            ++pruned;
+        }
+
+        std::sort(next.begin(), next.end());
+        next.erase(std::unique(next.begin(), next.end()), next.end());
+        frontier.swap(next);
+    }
+
+    return open_count > 0 ? static_cast<float>(pruned) / open_count : 0.0f;
+}
+
+// Entry costs for weighted models from a file shaped like the maze: a digit is the weight of
+// the tile under it, any other character leaves the tile at 0. Weights never lower a cost, so
+// the heuristic stays admissible and pruned dead ends stay useless.
+inline void maze_t::load_weights(const char* filepath)
+{
+    const std::vector<std::string> lines = util::read_file(filepath);
+    if (lines.size() != static_cast<std::size_t>(size.y))
+        throw std::runtime_error("Weight file doesn't match the maze size.");
+
+    for (int y = 0; y < size.y; ++y)
+    {
+        std::string line = lines[y];
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.size() != static_cast<std::size_t>(size.x))
+            throw std::runtime_error("Weight file doesn't match the maze size.");
+
+        for (int x = 0; x < size.x; ++x)
+        {
+            const char c = line[x];
+            get(x, y).weight = (c >= '0' && c <= '9') ? static_cast<u8>(c - '0') : u8(0);
+        }
+    }
+}
+
+inline void maze_t::unload()
+{
+    map = nullptr;
+    component = nullptr;
+    tile_arena.reset();
+}
+
+// Grid plus the last solve's search memory, over the tiles of the maze
+inline float maze_t::bytes_per_tile() const
+{
+    const std::size_t tiles = (std::size_t)size.x * size.y;
+    return tiles > 0 ? static_cast<float>(grid_bytes() + state_bytes + open_bytes) / tiles : 0.0f;
+}
+
+// The summary print() puts above the grid and writes to the console
+inline std::string maze_t::header() const
+{
+    std::ostringstream oss;
+    oss << "Dimensions: " << size.x << " x " << size.y << std::endl;
+    oss << "Best path cost " << path_cost << " points";
+    if (path_bound > 1.0f)
+        oss << " (at most " << path_bound << "x the optimum)";
+    oss << std::endl;
+    if (pruned > 0)
+        oss << "Pruned " << pruned << " dead-end tiles (" << std::round(1000.0f * pruned / open_count) / 10.0f << "% of open)" << std::endl;
+    oss << "Solved in: " << solve_time << " ms. Search count: " << search_count;
+#if DEBUG_BUILD
+    oss << " (debug build)" << std::endl;
+#else
+    oss << " (release build)" << std::endl;
+#endif
+    oss << "Memory: grid " << util::format_bytes(grid_bytes());
+    if (state_bytes > 0)
+    {
+        oss << ", search state " << util::format_bytes(state_bytes) << ", open list " << util::format_bytes(open_bytes)
+            << " (peak " << peak_open << " entries)";
+    }
+    oss << ", " << std::round(10.0f * bytes_per_tile()) / 10.0f << " bytes per tile. Peak RSS "
+        << util::format_bytes(util::peak_rss_bytes()) << std::endl;
+    return oss.str();
+}
+
+inline void maze_t::print(const char* filepath) const
+{
+    const std::string summary = header();
+
+    // Short output for console
+    std::cout << summary;
+
+    // Full output for file, rendered straight into place one band of rows per task
+    const std::size_t stride = (std::size_t)size.x + 1;
+    std::string text = summary;
+    const std::size_t offset = text.size();
+    text.resize(offset + stride * size.y);
+    util::parallel_for(0, (std::size_t)size.y, 64, [&](std::size_t begin, std::size_t end)
+    {
+        for (int y = (int)begin; y < (int)end; ++y)
+        {
+            char* out = &text[offset + stride * y];
+            for (int x = 0; x < size.x; ++x)
+            {
+                out[x] = tile_to_char(get(x, y));
+            }
+            out[size.x] = '\n';
+        }
+    });
+
+    util::write_file(filepath, text);
+}
+
+// A* from the starts facing east to any facing on a goal. Reads the maze and nothing else of
+// it; the search records and open list live in the caller's scratch arena, which is rewound
+// first. The open list is any queue from queue.hpp.
+template <typename Model, template <typename> class Queue>
+inline solve_result_t maze_t::search(float weight, util::arena_t& scratch, const endpoints_t& endpoints) const
+{
+    solve_result_t result{};
+    result.bound = std::max(1.0f, weight);
+
+    util::stopwatch_t sw{};
+    sw.start();
+
+    if (endpoints.start_count == 0 || endpoints.goal_count == 0)
+    {
+        throw std::runtime_error("Maze must have a start (S) and an end (E).");
+    }
+
+    if (endpoints.every_goal)
+        result.goal_costs.assign(endpoints.goal_count, -1);
+
+    // Different components, nothing to search
+    bool any_connected = false;
+    for (std::size_t s = 0; s < endpoints.start_count && !any_connected; ++s)
+        for (std::size_t g = 0; g < endpoints.goal_count && !any_connected; ++g)
+            any_connected = connected(endpoints.starts[s], endpoints.goals[g]);
+    if (!any_connected)
+    {
+        result.solve_time = sw.elapsed_ms();
+        return result;
+    }
+
+    // Goals to aim the heuristic at, and for every-goal searches a sorted lookup from tile to goal
+    std::array<ivec2, multi_heuristic_goals> targets{};
+    const bool aimed = endpoints.goal_count <= multi_heuristic_goals;
+    for (std::size_t g = 0; aimed && g < endpoints.goal_count; ++g)
+        targets[g] = map[endpoints.goals[g]].pos;
+
+    std::vector<std::pair<std::size_t, std::size_t>> goal_index;
+    if (endpoints.every_goal)
+    {
+        for (std::size_t g = 0; g < endpoints.goal_count; ++g)
+            goal_index.emplace_back(endpoints.goals[g], g);
+        std::sort(goal_index.begin(), goal_index.end());
+    }
+
+    auto estimate = [&](const ivec2& pos, int facing) -> cost_t
+    {
+        if (!aimed)
+            return 0;
+        cost_t h = infinite_cost;
+        for (std::size_t g = 0; g < endpoints.goal_count; ++g)
+            h = std::min(h, heuristic<Model>(pos, facing, targets[g]));
+        return static_cast<cost_t>(weight * h);
+    };
+
+    // A single goal is compared by index, several by their E tiles
+    const std::size_t single_goal = endpoints.goals[0];
+    auto is_goal = [&](std::size_t tile)
+    {
+        return endpoints.goal_count == 1 ? tile == single_goal : map[tile].type == tile_e::end;
+    };
+
+    // One search record per (tile, facing), unvisited while its dir is none. Both the records
+    // and the open list live in the arena, so repeated queries reuse the same memory.
+    // The records are initialised on the pool for the same first-touch placement as the map.
+    scratch.reset();
+    state_t* states = scratch.allocate<state_t>(capacity() * facings);
+    util::parallel_for(0, capacity() * facings, std::size_t(1) << 16, [&](std::size_t begin, std::size_t end)
+    {
+        std::uninitialized_fill(states + begin, states + end, state_t{});
+    });
+    const std::size_t states_end = scratch.used();
+
+    // Priority queue for A* search, f = g + weight * h. Entries carry a snapshot of the state
+    // so a record improved after being queued leaves a stale entry that is skipped on pop.
+    struct open_t
+    {
+        state_t state;
+        std::size_t idx;
+
+        inline cost_t key() const { return state.f_cost(); }
+        inline bool operator>(const open_t& other) const { return state > other.state; }
+    };
+    Queue<open_t> pq(scratch);
+
+    // Initialize A* with every starting tile facing east
+    for (std::size_t s = 0; s < endpoints.start_count; ++s)
+    {
+        const std::size_t start = state_id(endpoints.starts[s], (int)dir_e::e);
+        if (states[start].dir != dir_e::none)
+            continue;
+        states[start].dir = dir_e::e;
+        states[start].h_cost = estimate(map[endpoints.starts[s]].pos, (int)dir_e::e);
+        states[start].p_idx = start;
+        pq.push(open_t{ states[start], start });
+        result.pushed++;
+    }
+
+    std::size_t goal_state = 0;
+    std::size_t goals_reached = 0;
+    while (!pq.empty())
+    {
+        result.peak_open = std::max(result.peak_open, pq.size());
+        const open_t top = pq.top();
+        pq.pop();
+
+        const state_t& current = states[top.idx];
+        if (top.state.g_cost > current.g_cost)
+            continue;
+
+        const std::size_t tile = state_tile(top.idx);
+
+        // The first goal state popped is within weight of the optimum. Every-goal searches
+        // note each goal the first time one of its facings pops and carry on past it.
+        if (is_goal(tile))
+        {
+            if (!result.found())
+            {
+                result.cost = current.g_cost;
+                goal_state = top.idx;
+            }
+            if (!endpoints.every_goal)
+                break;
+
+            const auto it = std::lower_bound(goal_index.begin(), goal_index.end(), std::make_pair(tile, std::size_t(0)));
+            if (it != goal_index.end() && it->first == tile && result.goal_costs[it->second] < 0)
+            {
+                result.goal_costs[it->second] = current.g_cost;
+                if (++goals_reached == endpoints.goal_count)
+                    break;
+            }
+        }
+        ++result.expanded;
+
+        // Explore the open neighbours, one set bit of the exit mask each
+        for (unsigned exits = map[tile].exits; exits != 0; exits &= exits - 1)
+        {
+            const int move_dir = util::count_trailing_zeros(exits);
+            const std::size_t n = step(tile, move_dir);
+
+            // Calculate the cost of moving to this neighbor
+            const cost_t g_cost = current.g_cost + Model::move(state_facing(top.idx), move_dir) + Model::enter(map[n]);
+            const std::size_t neighbor_idx = state_id(n, move_dir);
+            state_t& next = states[neighbor_idx];
+
+            // If we found a cheaper path to this neighbor, update it
+            if (next.dir == dir_e::none || g_cost < next.g_cost)
+            {
+                next.dir = static_cast<dir_e>(move_dir); // Track direction
+                next.g_cost = g_cost;
+                next.h_cost = estimate(map[n].pos, move_dir);
+                next.p_idx = top.idx;
+                pq.push(open_t{ next, neighbor_idx });
+                result.pushed++;
+            }
+        }
+    }
+
+    // Follow the parent links back to the start it came from
+    if (result.found())
+    {
+        for (std::size_t curr = goal_state; ; curr = states[curr].p_idx)
+        {
+            result.path.push_back(curr);
+            if (states[curr].p_idx == curr)
+                break;
+        }
+        std::reverse(result.path.begin(), result.path.end());
+    }
+
+    // Everything the arena handed out after the records went to the open list
+    result.state_bytes = capacity() * facings * sizeof(state_t);
+    result.open_bytes = scratch.used() - states_end;
+
+    result.solve_time = sw.elapsed_ms();
+    return result;
+}
+
+// search() with the open list picked at run time
+template <typename Model>
+inline solve_result_t maze_t::search(float weight, util::arena_t& scratch, const endpoints_t& endpoints, queue_e queue) const
+{
+    switch (queue)
+    {
+    case queue_e::binary: return search<Model, binary_heap_t>(weight, scratch, endpoints);
+    case queue_e::quad: return search<Model, quad_heap_t>(weight, scratch, endpoints);
+    case queue_e::pairing: return search<Model, pairing_heap_t>(weight, scratch, endpoints);
+    case queue_e::radix:
+        if (weight > 1.0f)
+            throw std::invalid_argument("The radix heap needs keys that never decrease, which weighted A* breaks.");
+        return search<Model, radix_heap_t>(weight, scratch, endpoints);
+    case queue_e::bucket: return search<Model, bucket_queue_t>(weight, scratch, endpoints);
+    default: throw std::invalid_argument("Unknown queue.");
+    }
+}
+
+// From S to E, the first of each in the file
+template <typename Model>
+inline solve_result_t maze_t::query(float weight, util::arena_t& scratch, queue_e queue) const
+{
+    endpoints_t endpoints{};
+    endpoints.starts = &start_idx;
+    endpoints.start_count = start_idx != npos ? 1 : 0;
+    endpoints.goals = &end_idx;
+    endpoints.goal_count = end_idx != npos ? 1 : 0;
+    return search<Model>(weight, scratch, endpoints, queue);
+}
+
+// One exact search from every S at once. It stops at the nearest E, or with every_goal
+// settles them all and fills solve_result_t::goal_costs, which replaces a search per pair.
+template <typename Model>
+inline solve_result_t maze_t::multi_query(bool every_goal, util::arena_t& scratch, queue_e queue) const
+{
+    endpoints_t endpoints{};
+    endpoints.starts = starts.data();
+    endpoints.start_count = starts.size();
+    endpoints.goals = ends.data();
+    endpoints.goal_count = ends.size();
+    endpoints.every_goal = every_goal;
+    return search<Model>(1.0f, scratch, endpoints, queue);
+}
+
+// Same as above with scratch memory of its own, for callers without an arena to lend
+template <typename Model>
+inline solve_result_t maze_t::query(float weight, queue_e queue) const
+{
+    util::arena_t scratch{};
+    return query<Model>(weight, scratch, queue);
+}
+
+// Copies a result into the maze so print() can render it
+inline void maze_t::apply(const solve_result_t& result)
+{
+    for (std::size_t i = 0; i < capacity(); ++i)
+    {
+        map[i].dir = dir_e::none;
+    }
+
+    solve_time = result.solve_time;
+    search_count = static_cast<int>(result.pushed);
+    path_cost = result.cost;
+    path_bound = result.bound;
+    state_bytes = result.state_bytes;
+    open_bytes = result.open_bytes;
+    peak_open = result.peak_open;
+
+    for (std::size_t state : result.path)
+    {
+        map[state_tile(state)].dir = (dir_e)(state_facing(state) | (int)dir_e::path);
+    }
+}
+
+template <typename Model>
+inline void maze_t::solve(float weight, queue_e queue)
+{
+    const solve_result_t result = query<Model>(weight, search_arena, queue);
+
+    // Ensure we found a valid path
+    if (!result.found())
+    {
+        std::cerr << "No path found to the goal." << std::endl;
+    }
+
+    apply(result);
+}
+
+// Follows the parent links from the goal state and marks the tiles on the way
+inline void maze_t::mark_path(const state_t* states, std::size_t goal_state)
+{
+    std::size_t curr = goal_state;
+    while (true)
+    {
+        tile_t& t = map[state_tile(curr)];
+        t.dir = (dir_e)(state_facing(curr) | (int)dir_e::path);
+
+        if (states[curr].p_idx == curr)
+            break;
+        curr = states[curr].p_idx;
+    }
+}
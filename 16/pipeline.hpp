@@ -0,0 +1,153 @@
+#pragma once
+
+#include <maze.hpp>
+#include <compact.hpp>
+
+#include <iomanip>
+
+// Batch runs as a pipeline on the shared pool. Each maze is loaded and solved by one task of a
+// task group, a window of mazes ahead of the calling thread, which writes them out in order.
+// While it waits for the next maze the caller runs the group's queued tasks itself, so the
+// batch also goes through on a pool without workers. Only the window's mazes are in memory at
+// once, and with enough cores a batch takes about as long as writing it.
+
+struct batch_job_t
+{
+    std::string input;
+    std::string output;
+};
+
+struct batch_options_t
+{
+    layout_e layout{ layout_e::row_major };
+    std::string format{ "grid" };
+    bool prune{ false };
+    std::size_t depth{ 2 };     // Mazes loaded ahead of the writer on top of one per pool thread
+};
+
+// One "input [output]" pair per line, the output defaults to the input with ".out" appended
+static std::vector<batch_job_t> read_batch_list(const char* filepath)
+{
+    std::vector<batch_job_t> jobs;
+    for (const std::string& line : util::read_file(filepath))
+    {
+        std::istringstream iss(line);
+        batch_job_t job{};
+        if (!(iss >> job.input))
+            continue;
+        if (!(iss >> job.output))
+            job.output = job.input + ".out";
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+// Returns nonzero if any maze failed to load, solve or write
+static int run_batch(const std::vector<batch_job_t>& jobs, const batch_options_t& options)
+{
+    struct item_t
+    {
+        std::unique_ptr<maze_t> maze{};
+        std::string error{};
+        double load_ms{ 0.0 };
+        double solve_ms{ 0.0 };
+        std::atomic<bool> ready{ false };
+    };
+
+    util::thread_pool_t& pool = util::thread_pool_t::shared();
+    util::task_group_t group(pool);
+    std::vector<item_t> items(jobs.size());
+    const std::size_t window = options.depth + pool.concurrency();
+    double load_ms = 0.0, solve_ms = 0.0, write_ms = 0.0;
+    util::stopwatch_t total{};
+
+    // A failed step keeps the item with its error, so the writer still reports it in order
+    auto process = [&](std::size_t j)
+    {
+        item_t& item = items[j];
+        util::stopwatch_t load_sw{};
+        try
+        {
+            item.maze.reset(new maze_t{});
+            item.maze->load(jobs[j].input.c_str(), options.layout);
+            if (options.prune)
+                item.maze->prune();
+        }
+        catch (const std::exception& e)
+        {
+            item.error = e.what();
+        }
+        item.load_ms = load_sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+
+        util::stopwatch_t solve_sw{};
+        if (item.error.empty())
+        {
+            try
+            {
+                item.maze->solve();
+            }
+            catch (const std::exception& e)
+            {
+                item.error = e.what();
+            }
+        }
+        item.solve_ms = solve_sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+        item.ready.store(true, std::memory_order_release);
+    };
+
+    std::size_t submitted = 0;
+    for (; submitted < std::min(window, jobs.size()); ++submitted)
+        group.run([&process, submitted] { process(submitted); });
+
+    int failures = 0;
+    for (std::size_t j = 0; j < jobs.size(); ++j)
+    {
+        item_t& item = items[j];
+        while (!item.ready.load(std::memory_order_acquire))
+        {
+            if (!pool.run_one(&group))
+                std::this_thread::yield();
+        }
+
+        util::stopwatch_t sw{};
+        const batch_job_t& job = jobs[j];
+        load_ms += item.load_ms;
+        solve_ms += item.solve_ms;
+        if (item.error.empty())
+        {
+            try
+            {
+                std::cout << job.input << std::endl;
+                if (options.format == "path")
+                    write_compact_path(*item.maze, job.output.c_str());
+                else
+                    item.maze->print(job.output.c_str());
+            }
+            catch (const std::exception& e)
+            {
+                item.error = e.what();
+            }
+        }
+
+        if (!item.error.empty())
+        {
+            std::cerr << "Error in " << job.input << ": " << item.error << std::endl;
+            ++failures;
+        }
+        item.maze.reset();
+        write_ms += sw.elapsed<std::chrono::duration<double, std::milli>>().count();
+
+        // The slot just written frees room for the next maze
+        if (submitted < jobs.size())
+        {
+            group.run([&process, submitted] { process(submitted); });
+            ++submitted;
+        }
+    }
+    group.wait();
+
+    std::cout << "Batch of " << jobs.size() << " in " << total.elapsed_ms() << " ms. Stage totals: load "
+        << std::fixed << std::setprecision(1) << load_ms << " ms, solve " << solve_ms << " ms, write " << write_ms << " ms"
+        << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,397 @@
+#pragma once
+
+#include <util.hpp>
+
+#include <algorithm>
+#include <limits>
+
+// Open lists. Every queue takes its memory from an arena and has the same small interface, so
+// a search takes the queue as a template parameter and any of them drops in:
+//
+//   Queue<T> q(arena); q.push(t); q.top(); q.pop(); q.empty(); q.size();
+//
+// The heaps order entries by T's operator>, meaning "pops after". The integer queues order by
+// T::key() alone, a non-negative integer, and pop entries with equal keys in any order. The
+// radix heap also needs every key pushed to be at least the last key popped, which A* with a
+// consistent heuristic guarantees and weighted A* does not.
+
+enum struct queue_e : std::uint8_t { binary, quad, pairing, radix, bucket };
+
+inline const char* queue_name(queue_e kind)
+{
+    switch (kind)
+    {
+    case queue_e::binary: return "binary";
+    case queue_e::quad: return "quad";
+    case queue_e::pairing: return "pairing";
+    case queue_e::radix: return "radix";
+    case queue_e::bucket: return "bucket";
+    default: return "?";
+    }
+}
+
+inline queue_e parse_queue(const std::string& name)
+{
+    if (name == "binary") return queue_e::binary;
+    if (name == "quad") return queue_e::quad;
+    if (name == "pairing") return queue_e::pairing;
+    if (name == "radix") return queue_e::radix;
+    if (name == "bucket") return queue_e::bucket;
+    throw std::invalid_argument("Unknown queue: " + name);
+}
+
+inline const std::vector<queue_e>& all_queues()
+{
+    static const std::vector<queue_e> list =
+        { queue_e::binary, queue_e::quad, queue_e::pairing, queue_e::radix, queue_e::bucket };
+    return list;
+}
+
+// The standard library's binary heap, what the solver has always used
+template <typename T>
+class binary_heap_t
+{
+public:
+    explicit binary_heap_t(util::arena_t& arena)
+        : m_items(util::arena_allocator_t<T>(arena))
+    {
+    }
+
+    void push(const T& item)
+    {
+        m_items.push_back(item);
+        std::push_heap(m_items.begin(), m_items.end(), after);
+    }
+
+    const T& top() const { return m_items.front(); }
+
+    void pop()
+    {
+        std::pop_heap(m_items.begin(), m_items.end(), after);
+        m_items.pop_back();
+    }
+
+    bool empty() const { return m_items.empty(); }
+    std::size_t size() const { return m_items.size(); }
+
+private:
+    static bool after(const T& a, const T& b) { return a > b; }
+
+    util::arena_vector_t<T> m_items;
+};
+
+// Four children per node: half the depth of a binary heap, and the children of a node share
+// a cache line or two, so pops touch less memory
+template <typename T>
+class quad_heap_t
+{
+public:
+    explicit quad_heap_t(util::arena_t& arena)
+        : m_items(util::arena_allocator_t<T>(arena))
+    {
+    }
+
+    void push(const T& item)
+    {
+        m_items.push_back(item);
+        std::size_t i = m_items.size() - 1;
+        while (i > 0)
+        {
+            const std::size_t parent = (i - 1) / arity;
+            if (!(m_items[parent] > item))
+                break;
+            m_items[i] = m_items[parent];
+            i = parent;
+        }
+        m_items[i] = item;
+    }
+
+    const T& top() const { return m_items.front(); }
+
+    void pop()
+    {
+        const T last = m_items.back();
+        m_items.pop_back();
+        const std::size_t n = m_items.size();
+        if (n == 0)
+            return;
+
+        // Sift the last entry down from the root
+        std::size_t i = 0;
+        while (true)
+        {
+            const std::size_t first = arity * i + 1;
+            if (first >= n)
+                break;
+
+            std::size_t best = first;
+            const std::size_t end = std::min(first + arity, n);
+            for (std::size_t c = first + 1; c < end; ++c)
+            {
+                if (m_items[best] > m_items[c])
+                    best = c;
+            }
+
+            if (!(last > m_items[best]))
+                break;
+            m_items[i] = m_items[best];
+            i = best;
+        }
+        m_items[i] = last;
+    }
+
+    bool empty() const { return m_items.empty(); }
+    std::size_t size() const { return m_items.size(); }
+
+private:
+    static constexpr std::size_t arity = 4;
+
+    util::arena_vector_t<T> m_items;
+};
+
+// Pairing heap: O(1) push, pops meld the root's children in two passes. Popped nodes go on a
+// free list the next pushes take from.
+template <typename T>
+class pairing_heap_t
+{
+public:
+    explicit pairing_heap_t(util::arena_t& arena)
+        : m_arena(arena)
+    {
+    }
+
+    void push(const T& item)
+    {
+        node_t* node = m_free;
+        if (node)
+            m_free = node->sibling;
+        else
+            node = m_arena.allocate<node_t>(1);
+        new (node) node_t{ item, nullptr, nullptr };
+
+        m_root = meld(m_root, node);
+        ++m_size;
+    }
+
+    const T& top() const { return m_root->item; }
+
+    void pop()
+    {
+        node_t* old = m_root;
+        m_root = merge_pairs(old->child);
+        old->sibling = m_free;
+        m_free = old;
+        --m_size;
+    }
+
+    bool empty() const { return m_size == 0; }
+    std::size_t size() const { return m_size; }
+
+private:
+    struct node_t
+    {
+        T item;
+        node_t* child;
+        node_t* sibling;
+    };
+
+    // Both roots must have no siblings
+    static node_t* meld(node_t* a, node_t* b)
+    {
+        if (!a)
+            return b;
+        if (!b)
+            return a;
+        if (a->item > b->item)
+            std::swap(a, b);
+        b->sibling = a->child;
+        a->child = b;
+        return a;
+    }
+
+    // Melds neighbouring pairs left to right, then the results right to left
+    static node_t* merge_pairs(node_t* first)
+    {
+        node_t* pairs = nullptr;
+        while (first)
+        {
+            node_t* a = first;
+            node_t* b = a->sibling;
+            if (!b)
+            {
+                a->sibling = pairs;
+                pairs = a;
+                break;
+            }
+
+            first = b->sibling;
+            a->sibling = b->sibling = nullptr;
+            node_t* m = meld(a, b);
+            m->sibling = pairs;
+            pairs = m;
+        }
+
+        node_t* root = nullptr;
+        while (pairs)
+        {
+            node_t* next = pairs->sibling;
+            pairs->sibling = nullptr;
+            root = meld(root, pairs);
+            pairs = next;
+        }
+        return root;
+    }
+
+    util::arena_t& m_arena;
+    node_t* m_root{ nullptr };
+    node_t* m_free{ nullptr };
+    std::size_t m_size{ 0 };
+};
+
+// Radix heap over 64-bit keys. Bucket b holds keys whose highest bit differing from the last
+// popped key is bit b - 1, bucket 0 holds keys equal to it. An entry only ever moves to lower
+// buckets, so each is moved at most 64 times and usually a handful.
+template <typename T>
+class radix_heap_t
+{
+public:
+    explicit radix_heap_t(util::arena_t& arena)
+    {
+        m_buckets.reserve(buckets);
+        for (std::size_t b = 0; b < buckets; ++b)
+            m_buckets.emplace_back(util::arena_allocator_t<T>(arena));
+    }
+
+    void push(const T& item)
+    {
+        const std::uint64_t k = static_cast<std::uint64_t>(item.key());
+        if (k < m_last)
+            throw std::logic_error("Radix heap key below the last one popped.");
+        m_buckets[bucket(k)].push_back(item);
+        ++m_size;
+    }
+
+    const T& top()
+    {
+        refill();
+        return m_buckets[0].back();
+    }
+
+    void pop()
+    {
+        refill();
+        m_buckets[0].pop_back();
+        --m_size;
+    }
+
+    bool empty() const { return m_size == 0; }
+    std::size_t size() const { return m_size; }
+
+private:
+    static constexpr std::size_t buckets = 65;
+
+    inline std::size_t bucket(std::uint64_t k) const
+    {
+        return k == m_last ? 0 : 64 - util::count_leading_zeros(k ^ m_last);
+    }
+
+    // Moves the lowest non-empty bucket down once bucket 0 runs dry
+    void refill()
+    {
+        if (!m_buckets[0].empty())
+            return;
+
+        std::size_t b = 1;
+        while (m_buckets[b].empty())
+            ++b;
+
+        std::uint64_t lowest = std::numeric_limits<std::uint64_t>::max();
+        for (const T& item : m_buckets[b])
+            lowest = std::min(lowest, static_cast<std::uint64_t>(item.key()));
+        m_last = lowest;
+
+        for (const T& item : m_buckets[b])
+            m_buckets[bucket(static_cast<std::uint64_t>(item.key()))].push_back(item);
+        m_buckets[b].clear();
+    }
+
+    std::vector<util::arena_vector_t<T>> m_buckets{};
+    std::uint64_t m_last{ 0 };
+    std::size_t m_size{ 0 };
+};
+
+// Bucket queue: one bucket per key on a ring covering every key in the queue. The ring starts
+// empty and doubles whenever the keys pushed spread wider than it, so a queue sized for a small
+// search costs no more than that search's key range. Pops scan forward from the lowest key. Unlike the radix
+// heap it takes keys below the last pop, so weighted A* can use it too.
+template <typename T>
+class bucket_queue_t
+{
+public:
+    explicit bucket_queue_t(util::arena_t& arena)
+        : m_arena(arena)
+    {
+    }
+
+    void push(const T& item)
+    {
+        const std::uint64_t k = static_cast<std::uint64_t>(item.key());
+        if (m_size == 0)
+        {
+            m_low = m_high = k;
+        }
+        else
+        {
+            m_low = std::min(m_low, k);
+            m_high = std::max(m_high, k);
+        }
+
+        if (m_high - m_low >= m_buckets.size())
+            resize(std::max<std::size_t>(1, m_buckets.size() * 2));
+        m_buckets[k & m_mask].push_back(item);
+        ++m_size;
+    }
+
+    const T& top()
+    {
+        while (m_buckets[m_low & m_mask].empty())
+            ++m_low;
+        return m_buckets[m_low & m_mask].back();
+    }
+
+    void pop()
+    {
+        top();
+        m_buckets[m_low & m_mask].pop_back();
+        --m_size;
+    }
+
+    bool empty() const { return m_size == 0; }
+    std::size_t size() const { return m_size; }
+
+private:
+    // Grows the ring until it covers low to high and moves every entry to its new slot
+    void resize(std::size_t n)
+    {
+        while (n <= m_high - m_low)
+            n *= 2;
+
+        std::vector<util::arena_vector_t<T>> old;
+        old.swap(m_buckets);
+        m_buckets.reserve(n);
+        for (std::size_t b = 0; b < n; ++b)
+            m_buckets.emplace_back(util::arena_allocator_t<T>(m_arena));
+        m_mask = n - 1;
+
+        for (const auto& bucket : old)
+            for (const T& item : bucket)
+                m_buckets[static_cast<std::uint64_t>(item.key()) & m_mask].push_back(item);
+    }
+
+    util::arena_t& m_arena;
+    std::vector<util::arena_vector_t<T>> m_buckets{};
+    std::uint64_t m_mask{ 0 };
+    std::uint64_t m_low{ 0 };
+    std::uint64_t m_high{ 0 };
+    std::size_t m_size{ 0 };
+};
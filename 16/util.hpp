@@ -7,9 +7,60 @@
 #include <vector>
 #include <chrono>
 #include <stdexcept>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <cstddef>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace util
 {
+    inline int count_trailing_zeros(std::uint32_t v) noexcept
+    {
+#if defined(_MSC_VER)
+        unsigned long i;
+        _BitScanForward(&i, v);
+        return static_cast<int>(i);
+#else
+        return __builtin_ctz(v);
+#endif
+    }
+
+    // Position of the highest set bit counted from the top, v must not be zero
+    inline int count_leading_zeros(std::uint64_t v) noexcept
+    {
+#if defined(_MSC_VER)
+        unsigned long i;
+        _BitScanReverse64(&i, v);
+        return 63 - static_cast<int>(i);
+#else
+        return __builtin_clzll(v);
+#endif
+    }
+
     class stopwatch_t
     {
     public:
@@ -63,6 +114,25 @@ namespace util
         return lines;
 	}
 
+    static std::string read_file_bytes(const char* filepath)
+    {
+        std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file.");
+        }
+
+        std::string bytes(static_cast<std::size_t>(file.tellg()), '\0');
+        file.seekg(0);
+        file.read(&bytes[0], static_cast<std::streamsize>(bytes.size()));
+
+        if (!file)
+        {
+            throw std::runtime_error("Failed to read file.");
+        }
+        return bytes;
+    }
+
     static void write_file(const char* filepath, const std::string& text)
     {
         std::ofstream file(filepath);
@@ -78,4 +148,700 @@ namespace util
             throw std::runtime_error("Failed to write to file.");
         }
     }
-}
\ No newline at end of file
+
+    // Largest resident set the process has had so far, 0 where the platform can't tell
+    static std::size_t peak_rss_bytes()
+    {
+#if defined(__linux__)
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+        return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#elif defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.PeakWorkingSetSize;
+#else
+        return 0;
+#endif
+    }
+
+    // Byte counts for people, e.g. "512 B", "1.5 MB"
+    static std::string format_bytes(std::size_t bytes)
+    {
+        static constexpr const char* units[] = { "B", "KB", "MB", "GB", "TB" };
+        double value = static_cast<double>(bytes);
+        int unit = 0;
+        while (value >= 1024.0 && unit < 4)
+        {
+            value /= 1024.0;
+            ++unit;
+        }
+
+        std::ostringstream oss;
+        oss.precision(unit == 0 ? 0 : 1);
+        oss << std::fixed << value << " " << units[unit];
+        return oss.str();
+    }
+
+    // Read-only view of a whole file. The OS pages it in on demand and may drop clean pages
+    // under memory pressure, so files far larger than RAM can be mapped.
+    class mapped_file_t
+    {
+    public:
+        explicit mapped_file_t(const char* filepath)
+        {
+#if defined(__linux__)
+            m_fd = ::open(filepath, O_RDONLY);
+            if (m_fd < 0)
+                throw std::runtime_error("Failed to open file.");
+
+            struct stat st {};
+            if (fstat(m_fd, &st) != 0 || st.st_size == 0)
+            {
+                ::close(m_fd);
+                throw std::runtime_error("File is empty.");
+            }
+            m_size = static_cast<std::size_t>(st.st_size);
+
+            void* p = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+            if (p == MAP_FAILED)
+            {
+                ::close(m_fd);
+                throw std::runtime_error("Failed to map file.");
+            }
+            m_data = static_cast<const char*>(p);
+#elif defined(_WIN32)
+            m_file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+                throw std::runtime_error("Failed to open file.");
+
+            LARGE_INTEGER size{};
+            if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+            {
+                CloseHandle(m_file);
+                throw std::runtime_error("File is empty.");
+            }
+            m_size = static_cast<std::size_t>(size.QuadPart);
+
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            m_data = m_mapping != nullptr ? static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+            if (m_data == nullptr)
+            {
+                if (m_mapping != nullptr)
+                    CloseHandle(m_mapping);
+                CloseHandle(m_file);
+                throw std::runtime_error("Failed to map file.");
+            }
+#else
+            (void)filepath;
+            throw std::runtime_error("File mapping is not supported on this platform.");
+#endif
+        }
+
+        ~mapped_file_t()
+        {
+#if defined(__linux__)
+            munmap(const_cast<char*>(m_data), m_size);
+            ::close(m_fd);
+#elif defined(_WIN32)
+            UnmapViewOfFile(m_data);
+            CloseHandle(m_mapping);
+            CloseHandle(m_file);
+#endif
+        }
+
+        mapped_file_t(const mapped_file_t&) = delete;
+        mapped_file_t& operator=(const mapped_file_t&) = delete;
+
+        inline const char* data() const { return m_data; }
+        inline std::size_t size() const { return m_size; }
+
+    private:
+        const char* m_data{ nullptr };
+        std::size_t m_size{ 0 };
+#if defined(__linux__)
+        int m_fd{ -1 };
+#elif defined(_WIN32)
+        HANDLE m_file{ INVALID_HANDLE_VALUE };
+        HANDLE m_mapping{ nullptr };
+#endif
+    };
+
+    // How large buffers are backed. Transparent asks the kernel to use 2 MB pages where it can,
+    // huge insists on reserved 2 MB pages and falls back to transparent when none are free.
+    enum struct page_mode_e : std::uint8_t { small, transparent, huge };
+
+    inline page_mode_e parse_page_mode(const std::string& name)
+    {
+        if (name == "small") return page_mode_e::small;
+        if (name == "thp" || name == "transparent") return page_mode_e::transparent;
+        if (name == "huge") return page_mode_e::huge;
+        throw std::invalid_argument("Unknown page mode: " + name);
+    }
+
+    static constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+    struct page_block_t
+    {
+        char* data{ nullptr };
+        std::size_t size{ 0 };
+        bool mapped{ false };   // Came from the OS rather than operator new
+    };
+
+    // Memory for large buffers, untouched until first written so every page lands on the node
+    // of the thread that writes it first. Small mode, and platforms without page control, use
+    // operator new.
+    static page_block_t allocate_pages(std::size_t bytes, page_mode_e mode)
+    {
+        if (mode == page_mode_e::small)
+            return page_block_t{ static_cast<char*>(::operator new(bytes)), bytes, false };
+
+        const std::size_t size = (bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+#if defined(__linux__)
+#ifdef MAP_HUGETLB
+        if (mode == page_mode_e::huge)
+        {
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED)
+                return page_block_t{ static_cast<char*>(p), size, true };
+        }
+#endif
+        // Over-map by one huge page and trim, so the range starts on a 2 MB boundary
+        void* raw = mmap(nullptr, size + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            throw std::bad_alloc();
+
+        const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(raw);
+        const std::uintptr_t aligned = (begin + huge_page_size - 1) & ~static_cast<std::uintptr_t>(huge_page_size - 1);
+        if (aligned > begin)
+            munmap(raw, aligned - begin);
+        if (aligned + size < begin + size + huge_page_size)
+            munmap(reinterpret_cast<void*>(aligned + size), begin + huge_page_size - aligned);
+
+#ifdef MADV_HUGEPAGE
+        madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE);
+#endif
+        return page_block_t{ reinterpret_cast<char*>(aligned), size, true };
+#elif defined(_WIN32)
+        if (mode == page_mode_e::huge)
+        {
+            // Needs SeLockMemoryPrivilege, without it the call fails and we take normal pages
+            const std::size_t large = GetLargePageMinimum();
+            if (large > 0)
+            {
+                const std::size_t rounded = (bytes + large - 1) & ~(large - 1);
+                void* p = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+                if (p != nullptr)
+                    return page_block_t{ static_cast<char*>(p), rounded, true };
+            }
+        }
+
+        void* p = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (p == nullptr)
+            throw std::bad_alloc();
+        return page_block_t{ static_cast<char*>(p), size, true };
+#else
+        (void)size;
+        return page_block_t{ static_cast<char*>(::operator new(bytes)), bytes, false };
+#endif
+    }
+
+    static void free_pages(const page_block_t& block)
+    {
+        if (block.data == nullptr)
+            return;
+        if (!block.mapped)
+        {
+            ::operator delete(block.data);
+            return;
+        }
+#if defined(__linux__)
+        munmap(block.data, block.size);
+#elif defined(_WIN32)
+        VirtualFree(block.data, 0, MEM_RELEASE);
+#endif
+    }
+
+    // Monotonic arena. Allocations bump a pointer through large blocks and are never freed one
+    // by one; reset() rewinds everything at once and keeps the memory for the next round. A round
+    // that spilled over several blocks has them merged into one, so once the arena has seen its
+    // largest round it stops touching the heap and the pages it hands out are already mapped.
+    class arena_t
+    {
+    public:
+        arena_t() = default;
+        explicit arena_t(std::size_t block_size, page_mode_e pages = page_mode_e::small)
+            : m_block_size(block_size), m_pages(pages) {}
+        ~arena_t() { release(); }
+
+        arena_t(const arena_t&) = delete;
+        arena_t& operator=(const arena_t&) = delete;
+
+        arena_t(arena_t&& other) noexcept { *this = std::move(other); }
+        arena_t& operator=(arena_t&& other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                m_blocks.swap(other.m_blocks);
+                m_block_size = other.m_block_size;
+                m_pages = other.m_pages;
+                m_current = other.m_current;
+                m_offset = other.m_offset;
+                other.m_current = 0;
+                other.m_offset = 0;
+            }
+            return *this;
+        }
+
+        void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t))
+        {
+            while (true)
+            {
+                for (; m_current < m_blocks.size(); ++m_current, m_offset = 0)
+                {
+                    const page_block_t& b = m_blocks[m_current];
+                    const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(b.data);
+                    const std::uintptr_t p = (base + m_offset + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+                    if (p + bytes <= base + b.size)
+                    {
+                        m_offset = static_cast<std::size_t>(p - base) + bytes;
+                        return reinterpret_cast<void*>(p);
+                    }
+                }
+
+                m_blocks.push_back(allocate_pages(std::max(m_block_size, bytes + align), m_pages));
+            }
+        }
+
+        // Uninitialised room for n objects of T
+        template <typename T>
+        T* allocate(std::size_t n)
+        {
+            return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+        }
+
+        // Forgets every allocation but keeps the memory
+        void reset()
+        {
+            if (m_blocks.size() > 1)
+            {
+                const std::size_t total = capacity();
+                release();
+                m_blocks.push_back(allocate_pages(total, m_pages));
+            }
+            m_current = 0;
+            m_offset = 0;
+        }
+
+        // Hands every block back to the heap
+        void release()
+        {
+            for (const page_block_t& b : m_blocks)
+                free_pages(b);
+            m_blocks.clear();
+            m_current = 0;
+            m_offset = 0;
+        }
+
+        std::size_t capacity() const
+        {
+            std::size_t total = 0;
+            for (const page_block_t& b : m_blocks)
+                total += b.size;
+            return total;
+        }
+
+        std::size_t used() const
+        {
+            std::size_t total = m_offset;
+            for (std::size_t i = 0; i < m_current && i < m_blocks.size(); ++i)
+                total += m_blocks[i].size;
+            return total;
+        }
+
+        // Applies to blocks allocated from now on, including the one reset() merges into
+        void set_pages(page_mode_e pages) { m_pages = pages; }
+        page_mode_e pages() const { return m_pages; }
+
+    private:
+        std::vector<page_block_t> m_blocks{};
+        std::size_t m_block_size{ std::size_t(1) << 20 };
+        page_mode_e m_pages{ page_mode_e::small };
+        std::size_t m_current{ 0 };
+        std::size_t m_offset{ 0 };
+    };
+
+    // Standard allocator over an arena, deallocation is a no-op until the arena is reset
+    template <typename T>
+    struct arena_allocator_t
+    {
+        using value_type = T;
+
+        explicit arena_allocator_t(arena_t& arena) noexcept : arena(&arena) {}
+        template <typename U>
+        arena_allocator_t(const arena_allocator_t<U>& other) noexcept : arena(other.arena) {}
+
+        T* allocate(std::size_t n) { return arena->allocate<T>(n); }
+        void deallocate(T*, std::size_t) noexcept {}
+
+        template <typename U>
+        bool operator==(const arena_allocator_t<U>& other) const noexcept { return arena == other.arena; }
+        template <typename U>
+        bool operator!=(const arena_allocator_t<U>& other) const noexcept { return arena != other.arena; }
+
+        arena_t* arena;
+    };
+
+    template <typename T>
+    using arena_vector_t = std::vector<T, arena_allocator_t<T>>;
+
+    struct task_group_t;
+
+    // A queued unit of work and the group waiting on it
+    struct task_t
+    {
+        std::function<void()> fn;
+        task_group_t* group;
+    };
+
+    // Chase-Lev work-stealing deque. The owning worker pushes and pops at the bottom,
+    // any other thread steals from the top. The ring doubles when full; retired rings are
+    // kept until the deque dies because a thief may still be reading one.
+    class work_stealing_deque_t
+    {
+    public:
+        work_stealing_deque_t()
+        {
+            m_rings.emplace_back(new ring_t(64));
+            m_ring.store(m_rings.back().get(), std::memory_order_relaxed);
+        }
+
+        void push(task_t* task)
+        {
+            const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+            const std::int64_t t = m_top.load(std::memory_order_acquire);
+            ring_t* ring = m_ring.load(std::memory_order_relaxed);
+            if (b - t > ring->mask)
+                ring = grow(ring, b, t);
+
+            ring->put(b, task);
+            std::atomic_thread_fence(std::memory_order_release);
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        task_t* pop()
+        {
+            const std::int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+            ring_t* ring = m_ring.load(std::memory_order_relaxed);
+            m_bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t t = m_top.load(std::memory_order_relaxed);
+
+            if (t > b)
+            {
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            task_t* task = ring->get(b);
+            if (t == b)
+            {
+                // Last element, race the thieves for it
+                if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    task = nullptr;
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return task;
+        }
+
+        task_t* steal()
+        {
+            std::int64_t t = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const std::int64_t b = m_bottom.load(std::memory_order_acquire);
+            if (t >= b)
+                return nullptr;
+
+            task_t* task = m_ring.load(std::memory_order_acquire)->get(t);
+            if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return task;
+        }
+
+    private:
+        struct ring_t
+        {
+            explicit ring_t(std::int64_t capacity) : mask(capacity - 1), slots(new std::atomic<task_t*>[capacity]) {}
+
+            inline task_t* get(std::int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+            inline void put(std::int64_t i, task_t* task) { slots[i & mask].store(task, std::memory_order_relaxed); }
+
+            std::int64_t mask;
+            std::unique_ptr<std::atomic<task_t*>[]> slots;
+        };
+
+        ring_t* grow(ring_t* ring, std::int64_t b, std::int64_t t)
+        {
+            m_rings.emplace_back(new ring_t((ring->mask + 1) * 2));
+            ring_t* bigger = m_rings.back().get();
+            for (std::int64_t i = t; i < b; ++i)
+                bigger->put(i, ring->get(i));
+            m_ring.store(bigger, std::memory_order_release);
+            return bigger;
+        }
+
+        std::atomic<std::int64_t> m_top{ 0 };
+        std::atomic<std::int64_t> m_bottom{ 0 };
+        std::atomic<ring_t*> m_ring{ nullptr };
+        std::vector<std::unique_ptr<ring_t>> m_rings;
+    };
+
+    // Work-stealing pool. Each worker owns a Chase-Lev deque and steals from the others when
+    // it runs dry; threads outside the pool submit through a locked injection queue. A thread
+    // waiting on a task group runs queued tasks instead of blocking, so a pool with zero
+    // workers is valid and simply runs everything on the waiting thread. Outside threads only
+    // run tasks of the group they wait on: they all share the last slot(), and this way at most
+    // one of them ever works on a given group's tasks.
+    class thread_pool_t
+    {
+    public:
+        explicit thread_pool_t(unsigned workers, bool pin_threads = false)
+            : m_deques(workers)
+        {
+            for (unsigned i = 0; i < workers; ++i)
+                m_workers.emplace_back([this, i, pin_threads] { worker_loop(i, pin_threads); });
+        }
+
+        ~thread_pool_t()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            for (auto& w : m_workers)
+                w.join();
+        }
+
+        thread_pool_t(const thread_pool_t&) = delete;
+        thread_pool_t& operator=(const thread_pool_t&) = delete;
+
+        // Process-wide pool with one worker per core besides the calling thread
+        static thread_pool_t& shared()
+        {
+            static thread_pool_t pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+            return pool;
+        }
+
+        // Threads that can run tasks at once: the workers plus the one waiting
+        inline unsigned concurrency() const { return static_cast<unsigned>(m_workers.size()) + 1; }
+
+        // Index of the calling thread in [0, concurrency()), the last slot is any outside thread
+        inline unsigned slot() const
+        {
+            return tls_pool() == this ? static_cast<unsigned>(tls_worker()) : static_cast<unsigned>(m_workers.size());
+        }
+
+        void submit(task_t* task)
+        {
+            if (tls_pool() == this)
+            {
+                m_deques[tls_worker()].push(task);
+            }
+            else
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_injected.push_back(task);
+            }
+
+            m_pending.fetch_add(1, std::memory_order_release);
+            if (!m_workers.empty())
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_wake.notify_one();
+            }
+        }
+
+        // Runs one queued task on the calling thread, false if none could be found. Outside
+        // threads pass the group they wait on and only take its tasks.
+        bool run_one(const task_group_t* group = nullptr)
+        {
+            task_t* task = tls_pool() == this ? find_task() : find_injected(group);
+            if (task == nullptr)
+                return false;
+            execute(task);
+            return true;
+        }
+
+    private:
+        static int& tls_worker() { static thread_local int worker = -1; return worker; }
+        static thread_pool_t*& tls_pool() { static thread_local thread_pool_t* pool = nullptr; return pool; }
+
+        task_t* find_task()
+        {
+            if (m_pending.load(std::memory_order_acquire) == 0)
+                return nullptr;
+
+            task_t* task = nullptr;
+            const int self = tls_pool() == this ? tls_worker() : -1;
+            if (self >= 0)
+                task = m_deques[self].pop();
+
+            if (task == nullptr)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_injected.empty())
+                {
+                    task = m_injected.front();
+                    m_injected.pop_front();
+                }
+            }
+
+            // Steal starting after ourselves so thieves spread over the victims
+            const std::size_t n = m_deques.size();
+            for (std::size_t i = 0; task == nullptr && i < n; ++i)
+            {
+                const std::size_t victim = (static_cast<std::size_t>(self + 1) + i) % n;
+                if (static_cast<int>(victim) != self)
+                    task = m_deques[victim].steal();
+            }
+
+            if (task != nullptr)
+                m_pending.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+
+        // The first injected task of this group, or of any group when none is given
+        task_t* find_injected(const task_group_t* group)
+        {
+            if (m_pending.load(std::memory_order_acquire) == 0)
+                return nullptr;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto it = m_injected.begin(); it != m_injected.end(); ++it)
+            {
+                if (group == nullptr || (*it)->group == group)
+                {
+                    task_t* task = *it;
+                    m_injected.erase(it);
+                    m_pending.fetch_sub(1, std::memory_order_relaxed);
+                    return task;
+                }
+            }
+            return nullptr;
+        }
+
+        inline void execute(task_t* task);
+
+        void worker_loop(unsigned index, bool pin_thread)
+        {
+            tls_worker() = static_cast<int>(index);
+            tls_pool() = this;
+            if (pin_thread)
+                pin_to_cpu(index + 1);
+
+            while (true)
+            {
+                if (run_one())
+                    continue;
+
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_stop || m_pending.load(std::memory_order_acquire) > 0; });
+                if (m_stop)
+                    return;
+            }
+        }
+
+        static void pin_to_cpu(unsigned cpu)
+        {
+            const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+#if defined(_WIN32)
+            SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (cpu % cores));
+#elif defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu % cores, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+            (void)cpu;
+            (void)cores;
+#endif
+        }
+
+        std::vector<work_stealing_deque_t> m_deques;
+        std::vector<std::thread> m_workers;
+        std::deque<task_t*> m_injected;
+        std::atomic<std::int64_t> m_pending{ 0 };
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        bool m_stop{ false };
+    };
+
+    // Tasks that can be waited on together. wait() keeps the waiting thread busy with queued
+    // work, which is what makes nested groups on the same pool safe.
+    struct task_group_t
+    {
+        explicit task_group_t(thread_pool_t& pool = thread_pool_t::shared()) : pool(pool) {}
+        ~task_group_t() { wait(); }
+
+        void run(std::function<void()> fn)
+        {
+            pending.fetch_add(1, std::memory_order_relaxed);
+            pool.submit(new task_t{ std::move(fn), this });
+        }
+
+        void wait()
+        {
+            while (pending.load(std::memory_order_acquire) != 0)
+            {
+                if (!pool.run_one(this))
+                    std::this_thread::yield();
+            }
+        }
+
+        thread_pool_t& pool;
+        std::atomic<std::int64_t> pending{ 0 };
+    };
+
+    inline void thread_pool_t::execute(task_t* task)
+    {
+        task->fn();
+        task_group_t* group = task->group;
+        delete task;
+        group->pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Calls fn(begin, end) over chunks of at most grain indices and returns once all are done.
+    // Chunks always start at begin plus a multiple of grain, even when they all run on the caller.
+    template <typename Fn>
+    void parallel_for(thread_pool_t& pool, std::size_t begin, std::size_t end, std::size_t grain, Fn&& fn)
+    {
+        grain = std::max<std::size_t>(1, grain);
+        if (end <= begin)
+            return;
+        if (end - begin <= grain || pool.concurrency() == 1)
+        {
+            for (std::size_t b = begin; b < end; b += grain)
+                fn(b, std::min(end, b + grain));
+            return;
+        }
+
+        task_group_t group(pool);
+        for (std::size_t b = begin + grain; b < end; b += grain)
+        {
+            const std::size_t e = std::min(end, b + grain);
+            group.run([&fn, b, e] { fn(b, e); });
+        }
+        fn(begin, std::min(end, begin + grain));
+        group.wait();
+    }
+
+    template <typename Fn>
+    void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, Fn&& fn)
+    {
+        parallel_for(thread_pool_t::shared(), begin, end, grain, std::forward<Fn>(fn));
+    }
+}